@@ -0,0 +1,70 @@
+#include "allocators.hpp"
+
+#include <new>
+
+CountingAllocator::CountingAllocator(Opal::AllocatorBase* parent) : m_parent(parent) {}
+
+void* CountingAllocator::Alloc(u64 size, u64 alignment)
+{
+    m_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    m_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    return m_parent->Alloc(size, alignment);
+}
+
+void CountingAllocator::Free(void* ptr)
+{
+    m_parent->Free(ptr);
+}
+
+AllocationStats CountingAllocator::GetStats() const
+{
+    return {.allocation_count = m_allocation_count.load(std::memory_order_relaxed),
+            .allocated_bytes = m_allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+ArenaAllocator::ArenaAllocator(Opal::AllocatorBase* parent, u64 block_size)
+    : m_parent(parent != nullptr ? parent : Opal::GetDefaultAllocator()), m_block_size(block_size)
+{
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+    while (m_last_block != nullptr)
+    {
+        Block* previous = m_last_block->previous;
+        m_parent->Free(m_last_block);
+        m_last_block = previous;
+    }
+}
+
+static u8* AlignUp(u8* ptr, u64 alignment)
+{
+    const uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+    return ptr + ((alignment - address % alignment) % alignment);
+}
+
+void* ArenaAllocator::Alloc(u64 size, u64 alignment)
+{
+    m_stats.allocation_count++;
+    m_stats.allocated_bytes += size;
+
+    u8* ptr = m_cursor != nullptr ? AlignUp(m_cursor, alignment) : nullptr;
+    if (ptr == nullptr || ptr + size > m_end)
+    {
+        // Allocations that don't fit in a regular block get a block of their own.
+        const u64 header_size = (sizeof(Block) + alignment - 1) / alignment * alignment;
+        const u64 block_size = Opal::Max(m_block_size, header_size + size);
+        u8* block_memory = static_cast<u8*>(m_parent->Alloc(block_size, Opal::Max<u64>(alignment, alignof(Block))));
+        Block* block = new (block_memory) Block{.previous = m_last_block};
+        m_last_block = block;
+        m_end = block_memory + block_size;
+        ptr = block_memory + header_size;
+    }
+    m_cursor = ptr + size;
+    return ptr;
+}
+
+void ArenaAllocator::Free(void*)
+{
+    // Memory is released when the arena is destroyed.
+}
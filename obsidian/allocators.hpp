@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+
+#include "opal/allocator.h"
+
+#include "types.hpp"
+
+/**
+ * Allocator that forwards to another allocator and counts allocations, so that the number of heap allocations of each phase
+ * can be reported. Safe to use from multiple threads.
+ */
+class CountingAllocator : public Opal::AllocatorBase
+{
+public:
+    explicit CountingAllocator(Opal::AllocatorBase* parent);
+
+    void* Alloc(u64 size, u64 alignment) override;
+    void Free(void* ptr) override;
+
+    [[nodiscard]] AllocationStats GetStats() const;
+
+private:
+    Opal::AllocatorBase* m_parent = nullptr;
+    std::atomic<u64> m_allocation_count = 0;
+    std::atomic<u64> m_allocated_bytes = 0;
+};
+
+/**
+ * Bump allocator that takes memory from its parent in large blocks. Free does nothing, all memory is returned to the parent
+ * at once when the arena is destroyed, so it's meant for many short-lived allocations that die together. Not thread safe,
+ * use one arena per thread.
+ */
+class ArenaAllocator : public Opal::AllocatorBase
+{
+public:
+    static constexpr u64 k_default_block_size = 64 * 1024;
+
+    explicit ArenaAllocator(Opal::AllocatorBase* parent = nullptr, u64 block_size = k_default_block_size);
+    ~ArenaAllocator() override;
+
+    ArenaAllocator(const ArenaAllocator&) = delete;
+    ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+
+    void* Alloc(u64 size, u64 alignment) override;
+    void Free(void* ptr) override;
+
+    /**
+     * Allocations made through the arena. Blocks taken from the parent are counted by the parent.
+     */
+    [[nodiscard]] AllocationStats GetStats() const { return m_stats; }
+
+private:
+    struct Block
+    {
+        Block* previous = nullptr;
+    };
+
+    Opal::AllocatorBase* m_parent = nullptr;
+    u64 m_block_size = 0;
+    Block* m_last_block = nullptr;
+    u8* m_cursor = nullptr;
+    u8* m_end = nullptr;
+    AllocationStats m_stats;
+};
@@ -0,0 +1,801 @@
+#include "cache-file.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include "opal/container/json-writer.h"
+#include "opal/container/string-format.h"
+#include "opal/file-system.h"
+
+#include "cache.hpp"
+#include "hash.hpp"
+#include "system.hpp"
+
+static_assert(sizeof(CacheFileHeader) == 144, "Cache file header layout changed, increment the format version");
+static_assert(sizeof(CacheFileRecord) == 48, "Cache file record layout changed, increment the format version");
+static_assert(sizeof(CachePathIndexEntry) == 16, "Cache path index layout changed, increment the format version");
+static_assert(sizeof(CacheRecordIndexEntry) == 16, "Cache record index layout changed, increment the format version");
+
+bool CacheString::operator==(const Opal::StringUtf8& other) const
+{
+    return size == other.GetSize() && (size == 0 || std::memcmp(data, other.GetData(), size) == 0);
+}
+
+/**
+ * Sequential reader over encoded records. Values are copied out since records are not aligned. Reads past the end of the
+ * section throw CacheCorruptException.
+ */
+struct CacheRecordReader
+{
+    const char* data = nullptr;
+    u64 size = 0;
+    u64 offset = 0;
+
+    u32 ReadU32()
+    {
+        u32 value = 0;
+        Read(&value, sizeof(value));
+        return value;
+    }
+
+    i64 ReadI64()
+    {
+        i64 value = 0;
+        Read(&value, sizeof(value));
+        return value;
+    }
+
+    /**
+     * Read the element count of an array whose elements take at least min_element_size bytes each, so that a corrupt count
+     * fails here instead of reserving memory for it.
+     */
+    u32 ReadCount(u64 min_element_size)
+    {
+        const u32 count = ReadU32();
+        if (count > (size - offset) / min_element_size)
+        {
+            throw CacheCorruptException();
+        }
+        return count;
+    }
+
+    void Read(void* out_value, u64 value_size)
+    {
+        if (offset > size || size - offset < value_size)
+        {
+            throw CacheCorruptException();
+        }
+        std::memcpy(out_value, data + offset, value_size);
+        offset += value_size;
+    }
+};
+
+bool CacheView::Validate() const
+{
+    const CacheFileHeader& header = m_header;
+    // Sections are written in this order, each one ends before the next one starts. All of them are 8 byte aligned since the
+    // path index and dependency indices are read in place.
+    const u64 section_offsets[] = {sizeof(CacheFileHeader),
+                                   header.files_offset,
+                                   header.dependency_files_offset,
+                                   header.dependency_indices_offset,
+                                   header.path_index_offset,
+                                   header.enum_index_offset,
+                                   header.class_index_offset,
+                                   header.generated_files_offset,
+                                   header.records_offset,
+                                   header.string_table_offset,
+                                   header.file_size};
+    constexpr u64 k_section_count = sizeof(section_offsets) / sizeof(section_offsets[0]);
+    for (u64 i = 1; i < k_section_count; i++)
+    {
+        if (section_offsets[i] < section_offsets[i - 1] || (i < k_section_count - 1 && section_offsets[i] % 8 != 0))
+        {
+            return false;
+        }
+    }
+    const auto fits = [](u64 begin, u64 end, u64 count, u64 element_size) { return count <= (end - begin) / element_size; };
+    if (!fits(header.files_offset, header.dependency_files_offset, header.file_count, sizeof(CacheFileRecord)) ||
+        !fits(header.dependency_files_offset, header.dependency_indices_offset, header.dependency_file_count, sizeof(CacheFileRecord)) ||
+        !fits(header.path_index_offset, header.enum_index_offset, header.path_index_bucket_count, sizeof(CachePathIndexEntry)) ||
+        !fits(header.enum_index_offset, header.class_index_offset, header.enum_count, sizeof(CacheRecordIndexEntry)) ||
+        !fits(header.class_index_offset, header.generated_files_offset, header.class_count, sizeof(CacheRecordIndexEntry)) ||
+        !fits(header.generated_files_offset, header.records_offset, header.generated_file_count, sizeof(u32)))
+    {
+        return false;
+    }
+    // The mask in FindFile only works for powers of two.
+    const u32 bucket_count = header.path_index_bucket_count;
+    return (bucket_count == 0) == (header.file_count == 0) && (bucket_count & (bucket_count - 1)) == 0;
+}
+
+bool CacheView::Open(const Opal::StringUtf8& file_path)
+{
+    Close();
+    MappedFile file(file_path);
+    if (!file.IsValid() || file.GetSize() < sizeof(CacheFileHeader))
+    {
+        return false;
+    }
+    CacheFileHeader header;
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (std::memcmp(header.magic, CacheFileHeader::k_magic, sizeof(header.magic)) != 0)
+    {
+        Opal::GetLogger().Info("Obsidian", "Ignoring cache file {} since it's not in the binary cache format", *file_path);
+        return false;
+    }
+    if (header.format_version != CacheFileHeader::k_format_version)
+    {
+        Opal::GetLogger().Info("Obsidian", "Ignoring cache file {} since it was written in format version {}", *file_path,
+                               header.format_version);
+        return false;
+    }
+    // File size is written last, a partially written file doesn't match it.
+    if (header.file_size != file.GetSize() || header.string_table_offset > header.file_size)
+    {
+        Opal::GetLogger().Warning("Obsidian", "Ignoring cache file {} since it's truncated", *file_path);
+        return false;
+    }
+    m_file = Opal::Move(file);
+    m_header = header;
+    // Only the layout is checked here so that opening doesn't depend on the size of the cache. Everything that sections point
+    // to is checked when it's read.
+    if (!Validate())
+    {
+        Opal::GetLogger().Warning("Obsidian", "Ignoring cache file {} since it's corrupt", *file_path);
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void CacheView::Close()
+{
+    m_file = MappedFile();
+    m_header = CacheFileHeader();
+}
+
+CacheString CacheView::GetString(u32 offset) const
+{
+    CacheRecordReader reader{.data = m_file.GetData() + m_header.string_table_offset,
+                             .size = m_header.file_size - m_header.string_table_offset,
+                             .offset = offset};
+    const u32 size = reader.ReadU32();
+    // Null terminator has to fit as well.
+    if (static_cast<u64>(size) + 1 > reader.size - reader.offset)
+    {
+        throw CacheCorruptException();
+    }
+    return {.data = reader.data + reader.offset, .size = size};
+}
+
+CachedFile CacheView::ReadFileRecord(u64 offset) const
+{
+    CacheFileRecord record;
+    std::memcpy(&record, m_file.GetData() + offset, sizeof(record));
+    const u64 dependency_index_capacity = (m_header.path_index_offset - m_header.dependency_indices_offset) / sizeof(u32);
+    if (record.first_dependency > dependency_index_capacity ||
+        record.dependency_count > dependency_index_capacity - record.first_dependency)
+    {
+        throw CacheCorruptException();
+    }
+    const u32* dependencies = reinterpret_cast<const u32*>(m_file.GetData() + m_header.dependency_indices_offset) + record.first_dependency;
+    for (u32 i = 0; i < record.dependency_count; i++)
+    {
+        if (dependencies[i] >= m_header.dependency_file_count)
+        {
+            throw CacheCorruptException();
+        }
+    }
+    return {.path = GetString(record.path),
+            .last_modified = record.last_modified,
+            .size = record.size,
+            .content_hash = record.content_hash,
+            .parse_duration = record.parse_duration,
+            .dependencies = Opal::ArrayView<const u32>(dependencies, record.dependency_count)};
+}
+
+CachedFile CacheView::GetFile(u32 index) const
+{
+    return ReadFileRecord(m_header.files_offset + static_cast<u64>(index) * sizeof(CacheFileRecord));
+}
+
+CachedFile CacheView::GetDependencyFile(u32 index) const
+{
+    return ReadFileRecord(m_header.dependency_files_offset + static_cast<u64>(index) * sizeof(CacheFileRecord));
+}
+
+u32 CacheView::FindFile(const Opal::StringUtf8& path) const
+{
+    const u32 bucket_count = m_header.path_index_bucket_count;
+    if (bucket_count == 0)
+    {
+        return k_invalid_index;
+    }
+    const u64 path_hash = HashXXH64(path.GetData(), path.GetSize());
+    const u64 bucket_mask = bucket_count - 1;
+    const auto* buckets = reinterpret_cast<const CachePathIndexEntry*>(m_file.GetData() + m_header.path_index_offset);
+    u64 bucket = path_hash & bucket_mask;
+    for (u32 probe = 0; probe < bucket_count; probe++, bucket = (bucket + 1) & bucket_mask)
+    {
+        const CachePathIndexEntry& entry = buckets[bucket];
+        if (entry.file_index == CachePathIndexEntry::k_empty)
+        {
+            return k_invalid_index;
+        }
+        if (entry.file_index >= m_header.file_count)
+        {
+            throw CacheCorruptException();
+        }
+        if (entry.path_hash == path_hash && GetFile(entry.file_index).path == path)
+        {
+            return entry.file_index;
+        }
+    }
+    // Table is written at most half full, so the probe ends at an empty bucket unless the file is corrupt.
+    throw CacheCorruptException();
+}
+
+CacheRecordIndexEntry CacheView::ReadRecordIndexEntry(u64 index_offset, u32 index) const
+{
+    CacheRecordIndexEntry entry;
+    std::memcpy(&entry, m_file.GetData() + index_offset + static_cast<u64>(index) * sizeof(CacheRecordIndexEntry), sizeof(entry));
+    return entry;
+}
+
+CacheRecordReader CacheView::GetRecordReader(u64 data_offset) const
+{
+    return {.data = m_file.GetData() + m_header.records_offset,
+            .size = m_header.string_table_offset - m_header.records_offset,
+            .offset = data_offset};
+}
+
+CacheString CacheView::GetEnumContainingFile(u32 index) const
+{
+    return GetString(ReadRecordIndexEntry(m_header.enum_index_offset, index).containing_file_path);
+}
+
+CacheString CacheView::GetEnumTranslationUnit(u32 index) const
+{
+    return GetString(ReadRecordIndexEntry(m_header.enum_index_offset, index).translation_unit_path);
+}
+
+CacheString CacheView::GetClassContainingFile(u32 index) const
+{
+    return GetString(ReadRecordIndexEntry(m_header.class_index_offset, index).containing_file_path);
+}
+
+CacheString CacheView::GetClassTranslationUnit(u32 index) const
+{
+    return GetString(ReadRecordIndexEntry(m_header.class_index_offset, index).translation_unit_path);
+}
+
+CacheString CacheView::GetGeneratedFile(u32 index) const
+{
+    u32 path = 0;
+    std::memcpy(&path, m_file.GetData() + m_header.generated_files_offset + static_cast<u64>(index) * sizeof(u32), sizeof(path));
+    return GetString(path);
+}
+
+Opal::DynamicArray<CppAttribute> CacheView::ReadAttributes(CacheRecordReader& reader) const
+{
+    Opal::DynamicArray<CppAttribute> attributes;
+    const u32 attribute_count = reader.ReadCount(2 * sizeof(u32));
+    attributes.Reserve(attribute_count);
+    for (u32 i = 0; i < attribute_count; i++)
+    {
+        CppAttribute attribute;
+        attribute.name = GetString(reader.ReadU32()).ToString();
+        attribute.value = GetString(reader.ReadU32()).ToString();
+        attributes.PushBack(std::move(attribute));
+    }
+    return attributes;
+}
+
+CppEnum CacheView::ReadEnum(u32 index) const
+{
+    const CacheRecordIndexEntry entry = ReadRecordIndexEntry(m_header.enum_index_offset, index);
+    CacheRecordReader reader = GetRecordReader(entry.data_offset);
+    CppEnum cpp_enum;
+    cpp_enum.containing_file_path = GetString(entry.containing_file_path).ToString();
+    cpp_enum.translation_unit_path = GetString(entry.translation_unit_path).ToString();
+    cpp_enum.name = GetString(reader.ReadU32()).ToString();
+    cpp_enum.full_name = GetString(reader.ReadU32()).ToString();
+    cpp_enum.scope = GetString(reader.ReadU32()).ToString();
+    cpp_enum.description = GetString(reader.ReadU32()).ToString();
+    cpp_enum.underlying_type = GetString(reader.ReadU32()).ToString();
+    cpp_enum.underlying_type_size = reader.ReadI64();
+    cpp_enum.is_enum_class = reader.ReadU32() != 0;
+    const u32 constant_count = reader.ReadCount(2 * sizeof(u32) + sizeof(i64));
+    cpp_enum.constants.Reserve(constant_count);
+    for (u32 i = 0; i < constant_count; i++)
+    {
+        CppEnumConstant constant;
+        constant.name = GetString(reader.ReadU32()).ToString();
+        constant.description = GetString(reader.ReadU32()).ToString();
+        constant.value = reader.ReadI64();
+        cpp_enum.constants.PushBack(std::move(constant));
+    }
+    cpp_enum.attributes = ReadAttributes(reader);
+    return cpp_enum;
+}
+
+CppClass CacheView::ReadClass(u32 index) const
+{
+    const CacheRecordIndexEntry entry = ReadRecordIndexEntry(m_header.class_index_offset, index);
+    CacheRecordReader reader = GetRecordReader(entry.data_offset);
+    CppClass cpp_class;
+    cpp_class.containing_file_path = GetString(entry.containing_file_path).ToString();
+    cpp_class.translation_unit_path = GetString(entry.translation_unit_path).ToString();
+    cpp_class.name = GetString(reader.ReadU32()).ToString();
+    cpp_class.full_name = GetString(reader.ReadU32()).ToString();
+    cpp_class.scope = GetString(reader.ReadU32()).ToString();
+    cpp_class.description = GetString(reader.ReadU32()).ToString();
+    cpp_class.is_struct = reader.ReadU32() != 0;
+    cpp_class.alignment = reader.ReadI64();
+    cpp_class.size = reader.ReadI64();
+    // Five strings, is_pod, three sizes and the attribute count.
+    const u32 property_count = reader.ReadCount(7 * sizeof(u32) + 3 * sizeof(i64));
+    cpp_class.properties.Reserve(property_count);
+    for (u32 i = 0; i < property_count; i++)
+    {
+        CppProperty property;
+        property.name = GetString(reader.ReadU32()).ToString();
+        property.type = GetString(reader.ReadU32()).ToString();
+        property.type_scope = GetString(reader.ReadU32()).ToString();
+        property.full_type = GetString(reader.ReadU32()).ToString();
+        property.description = GetString(reader.ReadU32()).ToString();
+        property.is_pod = reader.ReadU32() != 0;
+        property.alignment = reader.ReadI64();
+        property.offset = reader.ReadI64();
+        property.size = reader.ReadI64();
+        property.attributes = ReadAttributes(reader);
+        cpp_class.properties.PushBack(std::move(property));
+    }
+    cpp_class.attributes = ReadAttributes(reader);
+    return cpp_class;
+}
+
+static FileEntry ToFileEntry(const CachedFile& file)
+{
+    FileEntry entry;
+    entry.path = file.path.ToString();
+    entry.last_modified = file.last_modified;
+    entry.size = file.size;
+    entry.content_hash = file.content_hash;
+    entry.parse_duration = file.parse_duration;
+    for (const u32 dependency_index : file.dependencies)
+    {
+        entry.dependencies.PushBack(dependency_index);
+    }
+    return entry;
+}
+
+Cache CacheView::Decode() const
+{
+    Cache cache;
+    cache.app_version = GetAppVersion().ToString();
+    cache.arguments_hash = GetArgumentsHash();
+    cache.peak_translation_unit_memory = GetPeakTranslationUnitMemory();
+    cache.has_records = HasRecords();
+    for (u32 i = 0; i < GetFileCount(); i++)
+    {
+        cache.files.PushBack(ToFileEntry(GetFile(i)));
+    }
+    for (u32 i = 0; i < GetDependencyFileCount(); i++)
+    {
+        cache.dependency_files.PushBack(ToFileEntry(GetDependencyFile(i)));
+    }
+    for (u32 i = 0; i < GetEnumCount(); i++)
+    {
+        cache.enums.PushBack(ReadEnum(i));
+    }
+    for (u32 i = 0; i < GetClassCount(); i++)
+    {
+        cache.classes.PushBack(ReadClass(i));
+    }
+    for (u32 i = 0; i < GetGeneratedFileCount(); i++)
+    {
+        cache.generated_files.PushBack(GetGeneratedFile(i).ToString());
+    }
+    return cache;
+}
+
+/**
+ * Builds the sections of the cache file in memory. Strings are deduplicated, most of them are paths and type names that repeat
+ * across records.
+ */
+class CacheFileWriter
+{
+public:
+    u32 AddString(const Opal::StringUtf8& str)
+    {
+        if (m_string_offsets.Contains(str))
+        {
+            return m_string_offsets[str];
+        }
+        const u32 offset = static_cast<u32>(m_string_table.GetSize());
+        const u32 size = static_cast<u32>(str.GetSize());
+        AppendBytes(m_string_table, &size, sizeof(size));
+        AppendBytes(m_string_table, str.GetData(), str.GetSize());
+        m_string_table.PushBack(0);
+        m_string_offsets.Insert(str.Clone(), offset);
+        return offset;
+    }
+
+    static void AppendBytes(Opal::DynamicArray<u8>& section, const void* data, u64 size)
+    {
+        const u64 offset = section.GetSize();
+        section.Resize(offset + size);
+        if (size > 0)
+        {
+            std::memcpy(section.GetData() + offset, data, size);
+        }
+    }
+
+    static void AppendU32(Opal::DynamicArray<u8>& section, u32 value) { AppendBytes(section, &value, sizeof(value)); }
+    static void AppendI64(Opal::DynamicArray<u8>& section, i64 value) { AppendBytes(section, &value, sizeof(value)); }
+
+    void AppendAttributes(Opal::DynamicArray<u8>& section, const Opal::DynamicArray<CppAttribute>& attributes)
+    {
+        AppendU32(section, static_cast<u32>(attributes.GetSize()));
+        for (const auto& attribute : attributes)
+        {
+            AppendU32(section, AddString(attribute.name));
+            AppendU32(section, AddString(attribute.value));
+        }
+    }
+
+    void AppendEnum(Opal::DynamicArray<u8>& section, const CppEnum& cpp_enum)
+    {
+        AppendU32(section, AddString(cpp_enum.name));
+        AppendU32(section, AddString(cpp_enum.full_name));
+        AppendU32(section, AddString(cpp_enum.scope));
+        AppendU32(section, AddString(cpp_enum.description));
+        AppendU32(section, AddString(cpp_enum.underlying_type));
+        AppendI64(section, cpp_enum.underlying_type_size);
+        AppendU32(section, cpp_enum.is_enum_class ? 1 : 0);
+        AppendU32(section, static_cast<u32>(cpp_enum.constants.GetSize()));
+        for (const auto& constant : cpp_enum.constants)
+        {
+            AppendU32(section, AddString(constant.name));
+            AppendU32(section, AddString(constant.description));
+            AppendI64(section, constant.value);
+        }
+        AppendAttributes(section, cpp_enum.attributes);
+    }
+
+    void AppendClass(Opal::DynamicArray<u8>& section, const CppClass& cpp_class)
+    {
+        AppendU32(section, AddString(cpp_class.name));
+        AppendU32(section, AddString(cpp_class.full_name));
+        AppendU32(section, AddString(cpp_class.scope));
+        AppendU32(section, AddString(cpp_class.description));
+        AppendU32(section, cpp_class.is_struct ? 1 : 0);
+        AppendI64(section, cpp_class.alignment);
+        AppendI64(section, cpp_class.size);
+        AppendU32(section, static_cast<u32>(cpp_class.properties.GetSize()));
+        for (const auto& property : cpp_class.properties)
+        {
+            AppendU32(section, AddString(property.name));
+            AppendU32(section, AddString(property.type));
+            AppendU32(section, AddString(property.type_scope));
+            AppendU32(section, AddString(property.full_type));
+            AppendU32(section, AddString(property.description));
+            AppendU32(section, property.is_pod ? 1 : 0);
+            AppendI64(section, property.alignment);
+            AppendI64(section, property.offset);
+            AppendI64(section, property.size);
+            AppendAttributes(section, property.attributes);
+        }
+        AppendAttributes(section, cpp_class.attributes);
+    }
+
+    void AppendFileRecord(Opal::DynamicArray<u8>& section, Opal::DynamicArray<u8>& dependency_indices, const FileEntry& file)
+    {
+        CacheFileRecord record;
+        record.path = AddString(file.path);
+        record.first_dependency = static_cast<u32>(dependency_indices.GetSize() / sizeof(u32));
+        record.dependency_count = static_cast<u32>(file.dependencies.GetSize());
+        record.last_modified = file.last_modified;
+        record.size = file.size;
+        record.content_hash = file.content_hash;
+        record.parse_duration = file.parse_duration;
+        for (const u32 dependency_index : file.dependencies)
+        {
+            AppendU32(dependency_indices, dependency_index);
+        }
+        AppendBytes(section, &record, sizeof(record));
+    }
+
+    [[nodiscard]] const Opal::DynamicArray<u8>& GetStringTable() const { return m_string_table; }
+
+private:
+    Opal::HashMap<Opal::StringUtf8, u32> m_string_offsets;
+    Opal::DynamicArray<u8> m_string_table;
+};
+
+static u64 AlignSectionOffset(u64 offset)
+{
+    return (offset + 7) & ~static_cast<u64>(7);
+}
+
+bool WriteCacheFile(const Cache& cache, const Opal::StringUtf8& file_path)
+{
+    CacheFileWriter writer;
+    CacheFileHeader header;
+    std::memcpy(header.magic, CacheFileHeader::k_magic, sizeof(header.magic));
+    header.format_version = CacheFileHeader::k_format_version;
+    header.app_version = writer.AddString(cache.app_version);
+    header.arguments_hash = cache.arguments_hash;
+    header.peak_translation_unit_memory = cache.peak_translation_unit_memory;
+    header.file_count = static_cast<u32>(cache.files.GetSize());
+    header.dependency_file_count = static_cast<u32>(cache.dependency_files.GetSize());
+    header.enum_count = static_cast<u32>(cache.enums.GetSize());
+    header.class_count = static_cast<u32>(cache.classes.GetSize());
+    header.has_records = cache.has_records ? 1 : 0;
+    header.generated_file_count = static_cast<u32>(cache.generated_files.GetSize());
+
+    Opal::DynamicArray<u8> files;
+    Opal::DynamicArray<u8> dependency_files;
+    Opal::DynamicArray<u8> dependency_indices;
+    Opal::DynamicArray<CachePathIndexEntry> path_index;
+    if (!cache.files.IsEmpty())
+    {
+        header.path_index_bucket_count = 1;
+        while (header.path_index_bucket_count < cache.files.GetSize() * 2)
+        {
+            header.path_index_bucket_count *= 2;
+        }
+        path_index.Resize(header.path_index_bucket_count);
+    }
+    const u64 bucket_mask = header.path_index_bucket_count - 1;
+    for (u32 i = 0; i < cache.files.GetSize(); i++)
+    {
+        writer.AppendFileRecord(files, dependency_indices, cache.files[i]);
+        const u64 path_hash = HashXXH64(cache.files[i].path.GetData(), cache.files[i].path.GetSize());
+        u64 bucket = path_hash & bucket_mask;
+        while (path_index[bucket].file_index != CachePathIndexEntry::k_empty)
+        {
+            bucket = (bucket + 1) & bucket_mask;
+        }
+        path_index[bucket] = {.path_hash = path_hash, .file_index = i};
+    }
+    for (const auto& dependency : cache.dependency_files)
+    {
+        writer.AppendFileRecord(dependency_files, dependency_indices, dependency);
+    }
+
+    Opal::DynamicArray<u8> records;
+    Opal::DynamicArray<CacheRecordIndexEntry> enum_index;
+    for (const auto& cpp_enum : cache.enums)
+    {
+        enum_index.PushBack({.containing_file_path = writer.AddString(cpp_enum.containing_file_path),
+                             .translation_unit_path = writer.AddString(cpp_enum.translation_unit_path),
+                             .data_offset = records.GetSize()});
+        writer.AppendEnum(records, cpp_enum);
+    }
+    Opal::DynamicArray<CacheRecordIndexEntry> class_index;
+    for (const auto& cpp_class : cache.classes)
+    {
+        class_index.PushBack({.containing_file_path = writer.AddString(cpp_class.containing_file_path),
+                              .translation_unit_path = writer.AddString(cpp_class.translation_unit_path),
+                              .data_offset = records.GetSize()});
+        writer.AppendClass(records, cpp_class);
+    }
+    Opal::DynamicArray<u8> generated_files;
+    for (const auto& path : cache.generated_files)
+    {
+        CacheFileWriter::AppendU32(generated_files, writer.AddString(path));
+    }
+
+    struct Section
+    {
+        u64* offset;
+        const void* data;
+        u64 size;
+    };
+    const Section sections[] = {
+        {&header.files_offset, files.GetData(), files.GetSize()},
+        {&header.dependency_files_offset, dependency_files.GetData(), dependency_files.GetSize()},
+        {&header.dependency_indices_offset, dependency_indices.GetData(), dependency_indices.GetSize()},
+        {&header.path_index_offset, path_index.GetData(), path_index.GetSize() * sizeof(CachePathIndexEntry)},
+        {&header.enum_index_offset, enum_index.GetData(), enum_index.GetSize() * sizeof(CacheRecordIndexEntry)},
+        {&header.class_index_offset, class_index.GetData(), class_index.GetSize() * sizeof(CacheRecordIndexEntry)},
+        {&header.generated_files_offset, generated_files.GetData(), generated_files.GetSize()},
+        {&header.records_offset, records.GetData(), records.GetSize()},
+        {&header.string_table_offset, writer.GetStringTable().GetData(), writer.GetStringTable().GetSize()},
+    };
+    u64 offset = sizeof(CacheFileHeader);
+    for (const Section& section : sections)
+    {
+        offset = AlignSectionOffset(offset);
+        *section.offset = offset;
+        offset += section.size;
+    }
+    header.file_size = offset;
+
+    // Written next to the destination and renamed over it, so other instances never map a partially written cache.
+    const Opal::StringUtf8 temp_file_path = Opal::Format("{}.{}.tmp", *file_path, GetProcessIdentifier());
+    FILE* file = std::fopen(*temp_file_path, "wb");
+    if (file == nullptr)
+    {
+        Opal::GetLogger().Warning("Obsidian", "Failed to open cache file {} for writing", *temp_file_path);
+        return false;
+    }
+    constexpr u8 k_padding[8] = {};
+    bool is_written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    u64 written_size = sizeof(header);
+    for (const Section& section : sections)
+    {
+        const u64 padding = *section.offset - written_size;
+        if (padding > 0)
+        {
+            is_written = is_written && std::fwrite(k_padding, 1, padding, file) == padding;
+        }
+        if (section.size > 0)
+        {
+            is_written = is_written && std::fwrite(section.data, 1, section.size, file) == section.size;
+        }
+        written_size = *section.offset + section.size;
+    }
+    is_written = std::fclose(file) == 0 && is_written;
+    if (!is_written || !RenameFileReplacingExisting(temp_file_path, file_path))
+    {
+        Opal::GetLogger().Warning("Obsidian", "Failed to write cache file {}", *file_path);
+        std::remove(*temp_file_path);
+        return false;
+    }
+    return true;
+}
+
+static Opal::JsonValue AttributesToJson(const Opal::DynamicArray<CppAttribute>& attributes)
+{
+    auto array = Opal::JsonValue::MakeArray();
+    for (const auto& attribute : attributes)
+    {
+        auto attribute_obj = Opal::JsonValue::MakeObject();
+        attribute_obj.Insert("name", Opal::JsonValue::MakeString(attribute.name));
+        attribute_obj.Insert("value", Opal::JsonValue::MakeString(attribute.value));
+        array.PushBack(std::move(attribute_obj));
+    }
+    return array;
+}
+
+static Opal::JsonValue EnumToJson(const CppEnum& cpp_enum)
+{
+    auto enum_obj = Opal::JsonValue::MakeObject();
+    enum_obj.Insert("containing_file_path", Opal::JsonValue::MakeString(cpp_enum.containing_file_path));
+    enum_obj.Insert("translation_unit_path", Opal::JsonValue::MakeString(cpp_enum.translation_unit_path));
+    enum_obj.Insert("name", Opal::JsonValue::MakeString(cpp_enum.name));
+    enum_obj.Insert("full_name", Opal::JsonValue::MakeString(cpp_enum.full_name));
+    enum_obj.Insert("scope", Opal::JsonValue::MakeString(cpp_enum.scope));
+    enum_obj.Insert("description", Opal::JsonValue::MakeString(cpp_enum.description));
+    enum_obj.Insert("underlying_type", Opal::JsonValue::MakeString(cpp_enum.underlying_type));
+    enum_obj.Insert("underlying_type_size", Opal::JsonValue::MakeNumber(static_cast<f64>(cpp_enum.underlying_type_size)));
+    enum_obj.Insert("is_enum_class", Opal::JsonValue::MakeBool(cpp_enum.is_enum_class));
+    auto constants_array = Opal::JsonValue::MakeArray();
+    for (const auto& constant : cpp_enum.constants)
+    {
+        auto constant_obj = Opal::JsonValue::MakeObject();
+        constant_obj.Insert("name", Opal::JsonValue::MakeString(constant.name));
+        constant_obj.Insert("description", Opal::JsonValue::MakeString(constant.description));
+        // Stored as a string since flag values don't fit in a double.
+        constant_obj.Insert("value", Opal::JsonValue::MakeString(Opal::Format("{}", constant.value)));
+        constants_array.PushBack(std::move(constant_obj));
+    }
+    enum_obj.Insert("constants", std::move(constants_array));
+    enum_obj.Insert("attributes", AttributesToJson(cpp_enum.attributes));
+    return enum_obj;
+}
+
+static Opal::JsonValue ClassToJson(const CppClass& cpp_class)
+{
+    auto class_obj = Opal::JsonValue::MakeObject();
+    class_obj.Insert("containing_file_path", Opal::JsonValue::MakeString(cpp_class.containing_file_path));
+    class_obj.Insert("translation_unit_path", Opal::JsonValue::MakeString(cpp_class.translation_unit_path));
+    class_obj.Insert("name", Opal::JsonValue::MakeString(cpp_class.name));
+    class_obj.Insert("full_name", Opal::JsonValue::MakeString(cpp_class.full_name));
+    class_obj.Insert("scope", Opal::JsonValue::MakeString(cpp_class.scope));
+    class_obj.Insert("description", Opal::JsonValue::MakeString(cpp_class.description));
+    class_obj.Insert("is_struct", Opal::JsonValue::MakeBool(cpp_class.is_struct));
+    class_obj.Insert("alignment", Opal::JsonValue::MakeNumber(static_cast<f64>(cpp_class.alignment)));
+    class_obj.Insert("size", Opal::JsonValue::MakeNumber(static_cast<f64>(cpp_class.size)));
+    auto properties_array = Opal::JsonValue::MakeArray();
+    for (const auto& property : cpp_class.properties)
+    {
+        auto property_obj = Opal::JsonValue::MakeObject();
+        property_obj.Insert("name", Opal::JsonValue::MakeString(property.name));
+        property_obj.Insert("type", Opal::JsonValue::MakeString(property.type));
+        property_obj.Insert("type_scope", Opal::JsonValue::MakeString(property.type_scope));
+        property_obj.Insert("full_type", Opal::JsonValue::MakeString(property.full_type));
+        property_obj.Insert("description", Opal::JsonValue::MakeString(property.description));
+        property_obj.Insert("is_pod", Opal::JsonValue::MakeBool(property.is_pod));
+        property_obj.Insert("alignment", Opal::JsonValue::MakeNumber(static_cast<f64>(property.alignment)));
+        property_obj.Insert("offset", Opal::JsonValue::MakeNumber(static_cast<f64>(property.offset)));
+        property_obj.Insert("size", Opal::JsonValue::MakeNumber(static_cast<f64>(property.size)));
+        property_obj.Insert("attributes", AttributesToJson(property.attributes));
+        properties_array.PushBack(std::move(property_obj));
+    }
+    class_obj.Insert("properties", std::move(properties_array));
+    class_obj.Insert("attributes", AttributesToJson(cpp_class.attributes));
+    return class_obj;
+}
+
+static Opal::JsonValue FileToJson(const FileEntry& file)
+{
+    auto file_obj = Opal::JsonValue::MakeObject();
+    file_obj.Insert("path", Opal::JsonValue::MakeString(file.path));
+    file_obj.Insert("last_modified", Opal::JsonValue::MakeNumber(file.last_modified));
+    file_obj.Insert("size", Opal::JsonValue::MakeNumber(file.size));
+    // JSON numbers are doubles, store the hash as a hex string so that no bits are lost.
+    file_obj.Insert("content_hash", Opal::JsonValue::MakeString(Opal::Format("{:016x}", file.content_hash)));
+    file_obj.Insert("parse_duration", Opal::JsonValue::MakeNumber(file.parse_duration));
+    auto dependencies_array = Opal::JsonValue::MakeArray();
+    for (const u32 dependency_index : file.dependencies)
+    {
+        dependencies_array.PushBack(Opal::JsonValue::MakeNumber(dependency_index));
+    }
+    file_obj.Insert("dependencies", std::move(dependencies_array));
+    return file_obj;
+}
+
+bool ExportCacheFileToJson(const Opal::StringUtf8& cache_file_path, const Opal::StringUtf8& json_file_path)
+{
+    CacheView view;
+    if (!view.Open(cache_file_path))
+    {
+        Opal::GetLogger().Warning("Obsidian", "Failed to read cache file {}", *cache_file_path);
+        return false;
+    }
+    Cache cache;
+    try
+    {
+        cache = view.Decode();
+    }
+    catch (const CacheCorruptException&)
+    {
+        Opal::GetLogger().Warning("Obsidian", "Failed to read cache file {} since it's corrupt", *cache_file_path);
+        return false;
+    }
+    auto root = Opal::JsonValue::MakeObject();
+    root.Insert("format_version", Opal::JsonValue::MakeNumber(CacheFileHeader::k_format_version));
+    root.Insert("app_version", Opal::JsonValue::MakeString(cache.app_version));
+    root.Insert("arguments_hash", Opal::JsonValue::MakeString(Opal::Format("{:016x}", cache.arguments_hash)));
+    root.Insert("peak_translation_unit_memory", Opal::JsonValue::MakeNumber(cache.peak_translation_unit_memory));
+    root.Insert("has_records", Opal::JsonValue::MakeBool(cache.has_records));
+    auto files_array = Opal::JsonValue::MakeArray();
+    for (const auto& file : cache.files)
+    {
+        files_array.PushBack(FileToJson(file));
+    }
+    root.Insert("files", std::move(files_array));
+    auto dependency_files_array = Opal::JsonValue::MakeArray();
+    for (const auto& dependency : cache.dependency_files)
+    {
+        dependency_files_array.PushBack(FileToJson(dependency));
+    }
+    root.Insert("dependency_files", std::move(dependency_files_array));
+    auto enums_array = Opal::JsonValue::MakeArray();
+    for (const auto& cpp_enum : cache.enums)
+    {
+        enums_array.PushBack(EnumToJson(cpp_enum));
+    }
+    root.Insert("enums", std::move(enums_array));
+    auto classes_array = Opal::JsonValue::MakeArray();
+    for (const auto& cpp_class : cache.classes)
+    {
+        classes_array.PushBack(ClassToJson(cpp_class));
+    }
+    root.Insert("classes", std::move(classes_array));
+    auto generated_files_array = Opal::JsonValue::MakeArray();
+    for (const auto& path : cache.generated_files)
+    {
+        generated_files_array.PushBack(Opal::JsonValue::MakeString(path));
+    }
+    root.Insert("generated_files", std::move(generated_files_array));
+    auto content = Opal::JsonWriter::Serialize(root, {.pretty = true});
+    Opal::WriteStringToFile(json_file_path, content);
+    Opal::GetLogger().Info("Obsidian", "Cache exported to {}", *json_file_path);
+    return true;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "types.hpp"
+#include "mapped-file.hpp"
+
+struct Cache;
+struct CacheRecordReader;
+
+/**
+ * Layout of the binary cache file. The file starts with the header, followed by sections whose offsets are stored in the
+ * header. All sections are 8 byte aligned. Strings are stored once in the string table, each as a u32 size followed by the
+ * bytes and a null terminator, and are referenced by their offset from the start of the string table.
+ */
+struct CacheFileHeader
+{
+    static constexpr char k_magic[8] = {'O', 'B', 'S', 'C', 'A', 'C', 'H', 'E'};
+    // Increment when the layout changes, caches in other formats are ignored.
+    static constexpr u32 k_format_version = 3;
+
+    char magic[8] = {};
+    u32 format_version = 0;
+    u32 app_version = 0;
+    u64 arguments_hash = 0;
+    u64 peak_translation_unit_memory = 0;
+    u64 file_size = 0;
+    u32 file_count = 0;
+    u32 dependency_file_count = 0;
+    u32 enum_count = 0;
+    u32 class_count = 0;
+    u32 has_records = 0;
+    // Power of two, zero when there are no input files.
+    u32 path_index_bucket_count = 0;
+    u32 generated_file_count = 0;
+    u32 reserved = 0;
+    // Array of CacheFileRecord for input files.
+    u64 files_offset = 0;
+    // Array of CacheFileRecord for included headers.
+    u64 dependency_files_offset = 0;
+    // Array of u32 indices into dependency files, referenced by CacheFileRecord::first_dependency.
+    u64 dependency_indices_offset = 0;
+    // Open addressing hash table of CachePathIndexEntry keyed on normalized path, see CacheView::FindFile.
+    u64 path_index_offset = 0;
+    // Arrays of CacheRecordIndexEntry, one per enum and class.
+    u64 enum_index_offset = 0;
+    u64 class_index_offset = 0;
+    // Array of u32 string offsets, paths of files written by the run that wrote the cache.
+    u64 generated_files_offset = 0;
+    // Encoded enums and classes, see CacheRecordIndexEntry::data_offset.
+    u64 records_offset = 0;
+    u64 string_table_offset = 0;
+};
+
+struct CacheFileRecord
+{
+    u32 path = 0;
+    u32 first_dependency = 0;
+    u32 dependency_count = 0;
+    u32 reserved = 0;
+    f64 last_modified = 0.0;
+    u64 size = 0;
+    u64 content_hash = 0;
+    f64 parse_duration = 0.0;
+};
+
+struct CachePathIndexEntry
+{
+    static constexpr u32 k_empty = ~0u;
+
+    u64 path_hash = 0;
+    u32 file_index = k_empty;
+    u32 reserved = 0;
+};
+
+/**
+ * Fields needed to decide if a record can be reused are stored in the index so that records don't have to be decoded.
+ */
+struct CacheRecordIndexEntry
+{
+    u32 containing_file_path = 0;
+    u32 translation_unit_path = 0;
+    // Offset from the start of the records section.
+    u64 data_offset = 0;
+};
+
+/**
+ * String stored in a mapped cache file. Points into the mapping, so it's only valid while the view is alive.
+ */
+struct CacheString
+{
+    const char* data = nullptr;
+    u32 size = 0;
+
+    [[nodiscard]] bool IsEmpty() const { return size == 0; }
+    [[nodiscard]] Opal::StringUtf8 ToString() const { return Opal::StringUtf8(data, size); }
+
+    bool operator==(const Opal::StringUtf8& other) const;
+};
+
+/**
+ * File entry read from a mapped cache file.
+ */
+struct CachedFile
+{
+    CacheString path;
+    f64 last_modified = 0.0;
+    u64 size = 0;
+    u64 content_hash = 0;
+    f64 parse_duration = 0.0;
+    Opal::ArrayView<const u32> dependencies;
+};
+
+/**
+ * Read-only view of a cache file. The file is memory mapped and nothing is decoded up front: file entries are read in place,
+ * input files are looked up through the hash table stored in the file and enums and classes are only decoded on request.
+ * Opening only checks the header and the section layout, strings and records are bounds checked when they are read and
+ * throw CacheCorruptException if they point outside of their section.
+ */
+class CacheView
+{
+public:
+    static constexpr u32 k_invalid_index = ~0u;
+
+    /**
+     * Map the cache file. Returns false if the file doesn't exist, was written in a different format or its sections don't
+     * fit in the file.
+     */
+    bool Open(const Opal::StringUtf8& file_path);
+    /**
+     * Unmap the file. Must be called before the cache file is written again.
+     */
+    void Close();
+
+    [[nodiscard]] bool IsValid() const { return m_file.IsValid(); }
+
+    [[nodiscard]] CacheString GetAppVersion() const { return GetString(m_header.app_version); }
+    [[nodiscard]] u64 GetArgumentsHash() const { return m_header.arguments_hash; }
+    [[nodiscard]] u64 GetPeakTranslationUnitMemory() const { return m_header.peak_translation_unit_memory; }
+    [[nodiscard]] bool HasRecords() const { return m_header.has_records != 0; }
+
+    [[nodiscard]] u32 GetFileCount() const { return m_header.file_count; }
+    [[nodiscard]] CachedFile GetFile(u32 index) const;
+    /**
+     * Index of the input file with the given normalized path, or k_invalid_index if there is no such file.
+     */
+    [[nodiscard]] u32 FindFile(const Opal::StringUtf8& path) const;
+
+    [[nodiscard]] u32 GetDependencyFileCount() const { return m_header.dependency_file_count; }
+    [[nodiscard]] CachedFile GetDependencyFile(u32 index) const;
+
+    [[nodiscard]] u32 GetEnumCount() const { return m_header.enum_count; }
+    [[nodiscard]] CacheString GetEnumContainingFile(u32 index) const;
+    [[nodiscard]] CacheString GetEnumTranslationUnit(u32 index) const;
+    [[nodiscard]] CppEnum ReadEnum(u32 index) const;
+
+    [[nodiscard]] u32 GetClassCount() const { return m_header.class_count; }
+    [[nodiscard]] CacheString GetClassContainingFile(u32 index) const;
+    [[nodiscard]] CacheString GetClassTranslationUnit(u32 index) const;
+    [[nodiscard]] CppClass ReadClass(u32 index) const;
+
+    [[nodiscard]] u32 GetGeneratedFileCount() const { return m_header.generated_file_count; }
+    [[nodiscard]] CacheString GetGeneratedFile(u32 index) const;
+
+    /**
+     * Decode the whole cache, used for exporting it.
+     */
+    [[nodiscard]] Cache Decode() const;
+
+private:
+    [[nodiscard]] bool Validate() const;
+    [[nodiscard]] CacheString GetString(u32 offset) const;
+    [[nodiscard]] CachedFile ReadFileRecord(u64 offset) const;
+    [[nodiscard]] CacheRecordIndexEntry ReadRecordIndexEntry(u64 index_offset, u32 index) const;
+    [[nodiscard]] CacheRecordReader GetRecordReader(u64 data_offset) const;
+    [[nodiscard]] Opal::DynamicArray<CppAttribute> ReadAttributes(CacheRecordReader& reader) const;
+
+    MappedFile m_file;
+    CacheFileHeader m_header;
+};
+
+/**
+ * Write the cache in the binary format. Returns false if the file can't be written.
+ */
+bool WriteCacheFile(const Cache& cache, const Opal::StringUtf8& file_path);
+
+/**
+ * Write the cache file as pretty-printed JSON, for debugging. Returns false if the cache file can't be read.
+ */
+bool ExportCacheFileToJson(const Opal::StringUtf8& cache_file_path, const Opal::StringUtf8& json_file_path);
@@ -1,12 +1,114 @@
 #include "cache.hpp"
 
-#include "opal/container/json-writer.h"
+#include <atomic>
+
+#include "opal/container/hash-set.h"
 #include "opal/container/string-format.h"
 #include "opal/file-system.h"
 #include "opal/paths.h"
+#include "opal/threading/thread-pool.h"
 #include "opal/time.h"
 
-Cache CreateCache(const ObsidianArguments& args, const Opal::DynamicArray<Opal::StringUtf8>& file_paths)
+#include "hash.hpp"
+#include "system.hpp"
+
+/**
+ * Modification time and size of the file, without the content hash. Files that don't exist anymore get zeros.
+ */
+static FileEntry DescribeFile(const Opal::StringUtf8& file_path)
+{
+    FileEntry entry;
+    entry.path = Opal::Paths::NormalizePath(file_path);
+    if (Opal::Exists(file_path))
+    {
+        entry.last_modified = Opal::GetLastFileModifiedTimeInSeconds(file_path);
+        entry.size = GetFileSizeInBytes(file_path);
+    }
+    else
+    {
+        entry.last_modified = 0.0;
+    }
+    return entry;
+}
+
+/**
+ * Modification time and size are only a quick check, hash from the previous run is reused if they didn't change. Returns false
+ * if the file needs to be hashed.
+ */
+static bool TryReuseContentHash(FileEntry& entry, const CachedFile* cached_entry)
+{
+    if (cached_entry != nullptr && cached_entry->content_hash != 0 && cached_entry->last_modified == entry.last_modified &&
+        cached_entry->size == entry.size)
+    {
+        entry.content_hash = cached_entry->content_hash;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Hash contents of the given files using all worker threads. Mapping and hashing are dominated by page faults and memory
+ * bandwidth, so the files are spread over workers that pull them one by one. Returns how the work was split between workers.
+ */
+static ParallelPhaseStats HashFilesParallel(Opal::DynamicArray<FileEntry*>& entries, u32 job_count)
+{
+    ParallelPhaseStats stats;
+    if (entries.IsEmpty())
+    {
+        return stats;
+    }
+    const f64 start_time = Opal::GetSeconds();
+    // Every entry is hashed by exactly one worker, so workers can write durations without synchronization.
+    Opal::DynamicArray<f64> durations;
+    durations.Resize(entries.GetSize());
+    const auto hash_entry = [&entries, &durations](u64 index)
+    {
+        const f64 entry_start_time = Opal::GetSeconds();
+        entries[index]->content_hash = HashFileContents(entries[index]->path);
+        durations[index] = Opal::GetSeconds() - entry_start_time;
+    };
+
+    const u64 worker_count = Opal::Min<u64>(Opal::Max<u32>(job_count, 1), entries.GetSize());
+    if (worker_count == 1)
+    {
+        for (u64 index = 0; index < entries.GetSize(); index++)
+        {
+            hash_entry(index);
+        }
+    }
+    else
+    {
+        Opal::ThreadPool thread_pool(static_cast<i32>(worker_count), 128);
+        std::atomic<u64> next_entry_index = 0;
+        Opal::DynamicArray<Opal::SharedPtr<Opal::Task>> tasks;
+        for (u64 i = 0; i < worker_count; i++)
+        {
+            tasks.PushBack(thread_pool.AddFunctionTask(
+                [&entries, &next_entry_index, &hash_entry](Opal::Task::TransmitterType& transmitter)
+                {
+                    for (u64 index = next_entry_index.fetch_add(1); index < entries.GetSize(); index = next_entry_index.fetch_add(1))
+                    {
+                        hash_entry(index);
+                    }
+                }));
+        }
+        for (auto& task : tasks)
+        {
+            task->WaitForCompletion();
+        }
+    }
+
+    stats.worker_count = static_cast<u32>(worker_count);
+    stats.duration = static_cast<f32>(Opal::GetSeconds() - start_time);
+    for (u64 index = 0; index < entries.GetSize(); index++)
+    {
+        stats.AddItem(durations[index], entries[index]->path);
+    }
+    return stats;
+}
+
+Cache CreateCache(const ObsidianArguments& args, const Opal::DynamicArray<Opal::StringUtf8>& file_paths, const CacheView* previous_cache,
+                  ParallelPhaseStats* hashing_stats)
 {
     Opal::StringUtf8 args_combined;
     args_combined.Reserve(1024);
@@ -34,6 +136,21 @@ Cache CreateCache(const ObsidianArguments& args, const Opal::DynamicArray<Opal::
         args_combined.Append(include_dir);
         args_combined.Append('\0');
     }
+    args_combined.Append(args.prelude_file);
+    args_combined.Append('\0');
+    if (!args.prelude_file.IsEmpty())
+    {
+        // The prelude is included by every input file, editing it can change any type, for example through a define.
+        const u64 prelude_hash = HashFileContents(args.prelude_file);
+        args_combined.Append(reinterpret_cast<const char*>(&prelude_hash), sizeof(prelude_hash));
+    }
+    args_combined.Append(args.use_separate_files ? '1' : '0');
+    // Traversal mode decides which declarations are visited, so it changes the set of reflected types.
+    args_combined.Append(static_cast<char>('0' + static_cast<u8>(args.traversal_mode)));
+    // Prescan skips translation units, which drops types from headers that only those translation units include.
+    args_combined.Append(args.should_prescan ? '1' : '0');
+    // Parse profile can change which files compile, which matters with keep-going.
+    args_combined.Append(static_cast<char>('0' + static_cast<u8>(args.parse_profile)));
     constexpr Opal::Hasher<Opal::StringUtf8> hasher;
     const u64 hash = hasher(args_combined);
     Cache cache;
@@ -42,87 +159,329 @@ Cache CreateCache(const ObsidianArguments& args, const Opal::DynamicArray<Opal::
     cache.files.Reserve(file_paths.GetSize());
     for (const auto& file_path : file_paths)
     {
-        FileEntry entry;
-        entry.path = Opal::Paths::NormalizePath(file_path);
-        entry.last_modified = Opal::GetLastFileModifiedTimeInSeconds(file_path);
-        cache.files.PushBack(std::move(entry));
+        cache.files.PushBack(DescribeFile(file_path));
+    }
+    // Headers included last time are checked as well. Their order is kept so that dependency indices stay valid.
+    if (previous_cache != nullptr)
+    {
+        cache.dependency_files.Reserve(previous_cache->GetDependencyFileCount());
+        for (u32 i = 0; i < previous_cache->GetDependencyFileCount(); i++)
+        {
+            cache.dependency_files.PushBack(DescribeFile(previous_cache->GetDependencyFile(i).path.ToString()));
+        }
+    }
+
+    Opal::DynamicArray<FileEntry*> entries_to_hash;
+    for (auto& entry : cache.files)
+    {
+        const u32 cached_index = previous_cache != nullptr ? previous_cache->FindFile(entry.path) : CacheView::k_invalid_index;
+        if (cached_index == CacheView::k_invalid_index)
+        {
+            entries_to_hash.PushBack(&entry);
+            continue;
+        }
+        const CachedFile cached_entry = previous_cache->GetFile(cached_index);
+        entry.dependencies.Reserve(cached_entry.dependencies.GetSize());
+        for (const u32 dependency_index : cached_entry.dependencies)
+        {
+            entry.dependencies.PushBack(dependency_index);
+        }
+        if (!TryReuseContentHash(entry, &cached_entry))
+        {
+            entries_to_hash.PushBack(&entry);
+        }
+    }
+    for (u32 i = 0; i < cache.dependency_files.GetSize(); i++)
+    {
+        const CachedFile cached_entry = previous_cache->GetDependencyFile(i);
+        if (!TryReuseContentHash(cache.dependency_files[i], &cached_entry))
+        {
+            entries_to_hash.PushBack(&cache.dependency_files[i]);
+        }
+    }
+    Opal::GetLogger().Verbose("Obsidian", "Hashing {} out of {} files", entries_to_hash.GetSize(),
+                              cache.files.GetSize() + cache.dependency_files.GetSize());
+    ParallelPhaseStats stats = HashFilesParallel(entries_to_hash, args.job_count);
+    if (hashing_stats != nullptr)
+    {
+        *hashing_stats = std::move(stats);
     }
     return cache;
 }
 
-bool SaveCacheToDisk(const Cache& cache)
+bool SaveCacheToDisk(const Cache& cache, const Opal::StringUtf8& cache_file_path)
 {
-    auto root = Opal::JsonValue::MakeObject();
-    root.Insert("app_version", Opal::JsonValue::MakeString(cache.app_version));
-    root.Insert("arguments_hash", Opal::JsonValue::MakeNumber(cache.arguments_hash));
-    auto files_array = Opal::JsonValue::MakeArray();
-    for (const auto& file : cache.files)
+    return WriteCacheFile(cache, cache_file_path);
+}
+
+bool LoadCacheFromDisk(const Opal::StringUtf8& cache_file_path, CacheView& out_view)
+{
+    return out_view.Open(cache_file_path);
+}
+
+CacheDiff CompareCaches(const CacheView& cached, const Cache& current_state)
+{
+    CacheDiff diff;
+    if (cached.GetAppVersion() != current_state.app_version)
     {
-        auto file_obj = Opal::JsonValue::MakeObject();
-        file_obj.Insert("path", Opal::JsonValue::MakeString(file.path));
-        file_obj.Insert("last_modified", Opal::JsonValue::MakeNumber(file.last_modified));
-        files_array.PushBack(std::move(file_obj));
+        Opal::GetLogger().Info("Obsidian", "Cache is stale because app version has changed.");
+        diff.is_app_version_changed = true;
+        return diff;
     }
-    root.Insert("files", std::move(files_array));
-    auto content = Opal::JsonWriter::Serialize(root, {.pretty = true});
-    Opal::WriteStringToFile("obs.cache", content);
-    return true;
+    if (cached.GetArgumentsHash() != current_state.arguments_hash)
+    {
+        Opal::GetLogger().Info("Obsidian", "Cache is stale because input arguments changed.");
+        diff.is_arguments_changed = true;
+        return diff;
+    }
+    Opal::DynamicArray<bool> is_cached_file_found;
+    is_cached_file_found.Reserve(cached.GetFileCount());
+    for (u32 i = 0; i < cached.GetFileCount(); i++)
+    {
+        is_cached_file_found.PushBack(false);
+    }
+    for (const auto& current_file : current_state.files)
+    {
+        const u32 cached_index = cached.FindFile(current_file.path);
+        if (cached_index == CacheView::k_invalid_index)
+        {
+            diff.added_files.PushBack(current_file.path.Clone());
+            continue;
+        }
+        is_cached_file_found[cached_index] = true;
+        if (cached.GetFile(cached_index).content_hash != current_file.content_hash)
+        {
+            diff.modified_files.PushBack(current_file.path.Clone());
+        }
+    }
+    for (u32 i = 0; i < cached.GetFileCount(); i++)
+    {
+        if (!is_cached_file_found[i])
+        {
+            diff.removed_files.PushBack(cached.GetFile(i).path.ToString());
+        }
+    }
+    // Dependency tables are in the same order, see CreateCache.
+    for (u32 i = 0; i < current_state.dependency_files.GetSize(); i++)
+    {
+        if (i >= cached.GetDependencyFileCount() || cached.GetDependencyFile(i).content_hash != current_state.dependency_files[i].content_hash)
+        {
+            diff.modified_dependencies.PushBack(i);
+        }
+    }
+
+    if (!diff.IsEmpty())
+    {
+        Opal::GetLogger().Info("Obsidian", "Cache is stale, {} input files added, {} removed, {} modified and {} included headers modified.",
+                               diff.added_files.GetSize(), diff.removed_files.GetSize(), diff.modified_files.GetSize(),
+                               diff.modified_dependencies.GetSize());
+    }
+    for (const auto& path : diff.added_files)
+    {
+        Opal::GetLogger().Verbose("Obsidian", "Added: {}", *path);
+    }
+    for (const auto& path : diff.removed_files)
+    {
+        Opal::GetLogger().Verbose("Obsidian", "Removed: {}", *path);
+    }
+    for (const auto& path : diff.modified_files)
+    {
+        Opal::GetLogger().Verbose("Obsidian", "Modified: {}", *path);
+    }
+    for (const u32 dependency_index : diff.modified_dependencies)
+    {
+        Opal::GetLogger().Verbose("Obsidian", "Modified included header: {}", *current_state.dependency_files[dependency_index].path);
+    }
+    return diff;
 }
 
-Opal::Expected<Cache, bool> LoadCacheFromDisk()
+/**
+ * Mark the input file that produced a record for parsing if the header declaring the record changed. Returns false if the
+ * record isn't attributed to any input file.
+ */
+static bool MarkRecordForParsing(const CacheString& containing_file_path, const CacheString& translation_unit_path,
+                                 const Opal::HashSet<Opal::StringUtf8>& changed_files, Opal::HashSet<Opal::StringUtf8>& files_to_parse)
 {
-    if (!Opal::Exists("obs.cache"))
+    if (!changed_files.Contains(Opal::Paths::NormalizePath(containing_file_path.ToString())))
     {
-        return Opal::Expected<Cache, bool>{false};
+        return true;
     }
-    Opal::StringUtf8 content = Opal::ReadFileAsString("obs.cache");
-    auto reader = Opal::JsonReader::Parse(std::move(content));
-    Cache cache;
-    cache.app_version = reader.GetRoot()["app_version"].GetString().ToString();
-    cache.arguments_hash = reader.GetRoot()["arguments_hash"].GetNumberAs<u64>();
-    for (auto& file_entry : reader.GetRoot()["files"])
+    if (translation_unit_path.IsEmpty())
+    {
+        return false;
+    }
+    Opal::StringUtf8 translation_unit = translation_unit_path.ToString();
+    if (!files_to_parse.Contains(translation_unit))
     {
-        FileEntry entry;
-        auto path_view = file_entry["path"].GetString();
-        entry.path = Opal::StringUtf8(path_view.GetData(), path_view.GetSize());
-        entry.last_modified = file_entry["last_modified"].GetNumberAs<f64>();
-        cache.files.PushBack(std::move(entry));
+        files_to_parse.Insert(Opal::Move(translation_unit));
     }
-    return Opal::Expected<Cache, bool>{std::move(cache)};
+    return true;
 }
 
-bool CompareCaches(const Cache& cached, const Cache& current_state)
+IncrementalPlan PlanIncrementalBuild(const CacheView& cached, const Cache& current_state, const CacheDiff& diff)
 {
-    if (cached.app_version != current_state.app_version)
+    IncrementalPlan plan;
+    if (!cached.HasRecords() || diff.is_app_version_changed || diff.is_arguments_changed)
     {
-        Opal::GetLogger().Info("Obsidian", "Cache is stale because app version has changed.");
-        return false;
+        return plan;
     }
-    if (cached.arguments_hash != current_state.arguments_hash)
+    if (!diff.removed_files.IsEmpty())
     {
-        Opal::GetLogger().Info("Obsidian", "Cache is stale because input arguments changed.");
-        return false;
+        Opal::GetLogger().Info("Obsidian", "Input file {} was removed, parsing all files again", *diff.removed_files[0]);
+        return plan;
     }
-    if (cached.files.GetSize() != current_state.files.GetSize())
+
+    Opal::HashSet<Opal::StringUtf8> changed_files;
+    Opal::HashSet<Opal::StringUtf8> files_to_parse;
+    for (const auto& path : diff.added_files)
     {
-        return false;
+        changed_files.Insert(path.Clone());
+        files_to_parse.Insert(path.Clone());
+    }
+    for (const auto& path : diff.modified_files)
+    {
+        changed_files.Insert(path.Clone());
+        files_to_parse.Insert(path.Clone());
     }
-    for (const auto& cached_file : cached.files)
+    Opal::DynamicArray<bool> is_dependency_changed;
+    is_dependency_changed.Reserve(current_state.dependency_files.GetSize());
+    for (u64 i = 0; i < current_state.dependency_files.GetSize(); i++)
     {
-        bool found = false;
-        for (const auto& current_file_state : current_state.files)
+        is_dependency_changed.PushBack(false);
+    }
+    for (const u32 dependency_index : diff.modified_dependencies)
+    {
+        changed_files.Insert(current_state.dependency_files[dependency_index].path.Clone());
+        is_dependency_changed[dependency_index] = true;
+    }
+    if (!diff.modified_dependencies.IsEmpty())
+    {
+        for (const auto& current_file : current_state.files)
         {
-            if (current_file_state.path == cached_file.path && current_file_state.last_modified > cached_file.last_modified)
+            for (const u32 dependency_index : current_file.dependencies)
             {
-                Opal::GetLogger().Info("Obsidian", "Cache is stale since a header file has been modified or was missing previously.");
-                found = true;
-                break;
+                if (is_dependency_changed[dependency_index])
+                {
+                    if (!files_to_parse.Contains(current_file.path))
+                    {
+                        files_to_parse.Insert(current_file.path.Clone());
+                    }
+                    break;
+                }
             }
         }
-        if (found)
+    }
+    for (u32 i = 0; i < cached.GetEnumCount(); i++)
+    {
+        if (!MarkRecordForParsing(cached.GetEnumContainingFile(i), cached.GetEnumTranslationUnit(i), changed_files, files_to_parse))
         {
-            return false;
+            return plan;
+        }
+    }
+    for (u32 i = 0; i < cached.GetClassCount(); i++)
+    {
+        if (!MarkRecordForParsing(cached.GetClassContainingFile(i), cached.GetClassTranslationUnit(i), changed_files, files_to_parse))
+        {
+            return plan;
+        }
+    }
+
+    plan.is_full_rebuild = false;
+    for (const auto& current_file : current_state.files)
+    {
+        if (files_to_parse.Contains(current_file.path))
+        {
+            plan.files_to_parse.PushBack(current_file.path.Clone());
+        }
+    }
+    // Only records that are reused are decoded.
+    for (u32 i = 0; i < cached.GetEnumCount(); i++)
+    {
+        if (!files_to_parse.Contains(cached.GetEnumTranslationUnit(i).ToString()))
+        {
+            plan.cached_enums.PushBack(cached.ReadEnum(i));
+        }
+    }
+    for (u32 i = 0; i < cached.GetClassCount(); i++)
+    {
+        if (!files_to_parse.Contains(cached.GetClassTranslationUnit(i).ToString()))
+        {
+            plan.cached_classes.PushBack(cached.ReadClass(i));
+        }
+    }
+    return plan;
+}
+
+void UpdateDependencies(Cache& cache, const Opal::DynamicArray<TranslationUnitIncludes>& includes, u32 job_count)
+{
+    Opal::HashMap<Opal::StringUtf8, u32> dependency_indices;
+    for (u32 i = 0; i < cache.dependency_files.GetSize(); i++)
+    {
+        dependency_indices.Insert(cache.dependency_files[i].path.Clone(), i);
+    }
+    Opal::HashMap<Opal::StringUtf8, u64> file_indices;
+    for (u64 i = 0; i < cache.files.GetSize(); i++)
+    {
+        file_indices.Insert(cache.files[i].path.Clone(), i);
+    }
+
+    const u64 known_dependency_count = cache.dependency_files.GetSize();
+    for (const auto& translation_unit : includes)
+    {
+        Opal::DynamicArray<u32> dependencies;
+        for (const auto& included_file : translation_unit.included_files)
+        {
+            if (!dependency_indices.Contains(included_file))
+            {
+                dependency_indices.Insert(included_file.Clone(), static_cast<u32>(cache.dependency_files.GetSize()));
+                cache.dependency_files.PushBack(DescribeFile(included_file));
+            }
+            dependencies.PushBack(dependency_indices[included_file]);
+        }
+        for (const auto& input_file : translation_unit.input_files)
+        {
+            if (file_indices.Contains(input_file))
+            {
+                cache.files[file_indices[input_file]].dependencies = dependencies.Clone();
+            }
+        }
+    }
+    Opal::DynamicArray<FileEntry*> entries_to_hash;
+    for (u64 i = known_dependency_count; i < cache.dependency_files.GetSize(); i++)
+    {
+        entries_to_hash.PushBack(&cache.dependency_files[i]);
+    }
+    HashFilesParallel(entries_to_hash, job_count);
+
+    // Drop headers that are not included by anything anymore and renumber the rest.
+    constexpr u32 k_unused = ~0u;
+    Opal::DynamicArray<u32> remapped_indices;
+    for (u64 i = 0; i < cache.dependency_files.GetSize(); i++)
+    {
+        remapped_indices.PushBack(k_unused);
+    }
+    for (const auto& file : cache.files)
+    {
+        for (const u32 dependency_index : file.dependencies)
+        {
+            remapped_indices[dependency_index] = 0;
+        }
+    }
+    Opal::DynamicArray<FileEntry> used_dependency_files;
+    for (u64 i = 0; i < cache.dependency_files.GetSize(); i++)
+    {
+        if (remapped_indices[i] != k_unused)
+        {
+            remapped_indices[i] = static_cast<u32>(used_dependency_files.GetSize());
+            used_dependency_files.PushBack(std::move(cache.dependency_files[i]));
+        }
+    }
+    cache.dependency_files = std::move(used_dependency_files);
+    for (auto& file : cache.files)
+    {
+        for (u32& dependency_index : file.dependencies)
+        {
+            dependency_index = remapped_indices[dependency_index];
         }
     }
-    return true;
 }
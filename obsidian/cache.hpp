@@ -1,23 +1,105 @@
 #pragma once
 
-#include "opal/container/expected.h"
-
 #include "types.hpp"
+#include "cache-file.hpp"
 
 struct FileEntry
 {
     Opal::StringUtf8 path;
     f64 last_modified;
+    u64 size = 0;
+    // Hash of the file contents, the file is considered changed only if this changes.
+    u64 content_hash = 0;
+    // Time it took to parse the file in the last run that parsed it, zero if it was never parsed.
+    f64 parse_duration = 0.0;
+    // Headers included by the file, directly or through other headers, as indices into Cache::dependency_files.
+    Opal::DynamicArray<u32> dependencies;
 };
 
 struct Cache
 {
     Opal::StringUtf8 app_version;
     u64 arguments_hash;
+    u64 peak_translation_unit_memory = 0;
     Opal::DynamicArray<FileEntry> files;
+    // All headers included by input files, excluding system headers. Shared between input files since most of them include
+    // the same headers.
+    Opal::DynamicArray<FileEntry> dependency_files;
+    // Records extracted in the last run, reused for input files that don't need to be parsed again.
+    bool has_records = false;
+    Opal::DynamicArray<CppEnum> enums;
+    Opal::DynamicArray<CppClass> classes;
+    // Normalized paths of files written to the output directory, so that the next run can remove the ones it doesn't write.
+    Opal::DynamicArray<Opal::StringUtf8> generated_files;
+};
+
+/**
+ * Difference between the cached and the current state of the input files.
+ */
+struct CacheDiff
+{
+    bool is_app_version_changed = false;
+    bool is_arguments_changed = false;
+    // Normalized paths of input files.
+    Opal::DynamicArray<Opal::StringUtf8> added_files;
+    Opal::DynamicArray<Opal::StringUtf8> removed_files;
+    Opal::DynamicArray<Opal::StringUtf8> modified_files;
+    // Indices into Cache::dependency_files of included headers that were modified.
+    Opal::DynamicArray<u32> modified_dependencies;
+
+    [[nodiscard]] bool IsEmpty() const
+    {
+        return !is_app_version_changed && !is_arguments_changed && added_files.IsEmpty() && removed_files.IsEmpty() &&
+               modified_files.IsEmpty() && modified_dependencies.IsEmpty();
+    }
 };
 
-Opal::Expected<Cache, bool> LoadCacheFromDisk();
-Cache CreateCache(const ObsidianArguments& args, const Opal::DynamicArray<Opal::StringUtf8>& file_paths);
-bool SaveCacheToDisk(const Cache& cache);
-bool CompareCaches(const Cache& cached, const Cache& current_state);
+/**
+ * What needs to be done to bring the reflection data up to date with the current state of the input files.
+ */
+struct IncrementalPlan
+{
+    // When true, all input files need to be parsed and nothing else in the plan is used.
+    bool is_full_rebuild = true;
+    // Normalized paths of input files that need to be parsed again.
+    Opal::DynamicArray<Opal::StringUtf8> files_to_parse;
+    // Records of input files that don't need to be parsed again.
+    Opal::DynamicArray<CppEnum> cached_enums;
+    Opal::DynamicArray<CppClass> cached_classes;
+};
+
+/**
+ * Map the cache written by the previous run. Returns false if there is no usable cache.
+ */
+bool LoadCacheFromDisk(const Opal::StringUtf8& cache_file_path, CacheView& out_view);
+/**
+ * Describe the current state of the input files. Content hashes are taken from the previous cache for files whose modification
+ * time and size didn't change, the rest of the files are hashed in parallel.
+ * @param hashing_stats If not null, receives how the hashing was split between workers.
+ */
+Cache CreateCache(const ObsidianArguments& args, const Opal::DynamicArray<Opal::StringUtf8>& file_paths,
+                  const CacheView* previous_cache = nullptr, ParallelPhaseStats* hashing_stats = nullptr);
+/**
+ * Write the cache file. The file is replaced atomically, so instances that load it at the same time see either the old or the
+ * new cache. Any view of the previous cache must be closed before calling this.
+ */
+bool SaveCacheToDisk(const Cache& cache, const Opal::StringUtf8& cache_file_path);
+/**
+ * Find input files that were added, removed or modified and included headers that were modified since the cache was written.
+ * Input files are matched through the path hash table of the cache file, so this is linear in the number of files. File lists
+ * are left empty if the app version or input arguments changed since everything is stale anyway.
+ */
+CacheDiff CompareCaches(const CacheView& cached, const Cache& current_state);
+
+/**
+ * Replace include dependencies of the input files that were just parsed, add headers that were not known before to the
+ * dependency table and drop the ones no input file includes anymore.
+ */
+void UpdateDependencies(Cache& cache, const Opal::DynamicArray<TranslationUnitIncludes>& includes, u32 job_count);
+
+/**
+ * Find out which input files need to be parsed again: files that were added or modified, files that include a modified header
+ * and files whose cached records come from a modified header. Records of all other files are decoded from the cached state.
+ * Falls back to a full rebuild if input files were removed or if the cached records can't be trusted.
+ */
+IncrementalPlan PlanIncrementalBuild(const CacheView& cached, const Cache& current_state, const CacheDiff& diff);
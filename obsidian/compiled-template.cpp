@@ -0,0 +1,75 @@
+#include "compiled-template.hpp"
+
+#include <cstring>
+
+CompiledTemplate::CompiledTemplate(const char* text, std::initializer_list<const char*> placeholders)
+{
+    const u64 text_size = strlen(text);
+    u64 literal_start = 0;
+    u64 position = 0;
+    while (position < text_size)
+    {
+        // All placeholders look like __name__, so only positions starting with an underscore need to be checked. The longest
+        // match wins so that a placeholder can be a prefix of another one.
+        u32 placeholder_index = k_literal;
+        u64 placeholder_size = 0;
+        if (text[position] == '_')
+        {
+            u32 index = 0;
+            for (const char* placeholder : placeholders)
+            {
+                const u64 size = strlen(placeholder);
+                if (size > placeholder_size && size <= text_size - position && memcmp(text + position, placeholder, size) == 0)
+                {
+                    placeholder_index = index;
+                    placeholder_size = size;
+                }
+                index++;
+            }
+        }
+        if (placeholder_index == k_literal)
+        {
+            position++;
+            continue;
+        }
+        if (position > literal_start)
+        {
+            m_segments.PushBack({.data = text + literal_start, .size = position - literal_start});
+            m_literal_size += position - literal_start;
+        }
+        m_segments.PushBack({.placeholder = placeholder_index});
+        position += placeholder_size;
+        literal_start = position;
+    }
+    if (text_size > literal_start)
+    {
+        m_segments.PushBack({.data = text + literal_start, .size = text_size - literal_start});
+        m_literal_size += text_size - literal_start;
+    }
+}
+
+void CompiledTemplate::Render(Opal::StringUtf8& out, std::initializer_list<const Opal::StringUtf8*> values) const
+{
+    const Opal::StringUtf8* const* value_data = values.begin();
+    u64 total_size = out.GetSize() + m_literal_size;
+    for (const Segment& segment : m_segments)
+    {
+        if (segment.placeholder != k_literal)
+        {
+            total_size += value_data[segment.placeholder]->GetSize();
+        }
+    }
+    out.Reserve(total_size);
+    for (const Segment& segment : m_segments)
+    {
+        if (segment.placeholder == k_literal)
+        {
+            out.Append(segment.data, segment.size);
+        }
+        else
+        {
+            const Opal::StringUtf8* value = value_data[segment.placeholder];
+            out.Append(value->GetData(), value->GetSize());
+        }
+    }
+}
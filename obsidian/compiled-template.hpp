@@ -0,0 +1,60 @@
+#pragma once
+
+#include <initializer_list>
+
+#include "types.hpp"
+#include "file-writer.hpp"
+
+/**
+ * Template text split once into literal segments and placeholders, so that it can be rendered in a single pass. Values are
+ * inserted as they are, placeholders that appear inside a value are not replaced.
+ */
+class CompiledTemplate
+{
+public:
+    /**
+     * Split the text at every occurrence of the given placeholders. The text must outlive the template, which holds for the
+     * templates in templates.hpp.
+     */
+    CompiledTemplate(const char* text, std::initializer_list<const char*> placeholders);
+
+    /**
+     * Append the template to the output with every placeholder replaced by the value with the same index as the placeholder
+     * had in the constructor, there must be a value for every placeholder. Output is grown once to fit the whole result.
+     */
+    void Render(Opal::StringUtf8& out, std::initializer_list<const Opal::StringUtf8*> values) const;
+
+    /**
+     * Stream the template to the file. Literal segments are written as they are and write_value is called with the index of
+     * every placeholder, so that values can be written in pieces instead of being joined first.
+     */
+    template <typename WriteValue>
+    void Render(StreamingFileWriter& out, WriteValue&& write_value) const
+    {
+        for (const Segment& segment : m_segments)
+        {
+            if (segment.placeholder == k_literal)
+            {
+                out.Write(segment.data, segment.size);
+            }
+            else
+            {
+                write_value(segment.placeholder);
+            }
+        }
+    }
+
+private:
+    static constexpr u32 k_literal = ~0u;
+
+    struct Segment
+    {
+        const char* data = nullptr;
+        u64 size = 0;
+        // Index of the placeholder, or k_literal for literal text.
+        u32 placeholder = k_literal;
+    };
+
+    Opal::DynamicArray<Segment> m_segments;
+    u64 m_literal_size = 0;
+};
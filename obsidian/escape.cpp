@@ -0,0 +1,229 @@
+#include "escape.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OBS_ESCAPE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#else
+#define OBS_ESCAPE_X86 0
+#endif
+
+// GCC and Clang only allow AVX2 intrinsics in functions compiled for AVX2, MSVC allows them everywhere.
+#if OBS_ESCAPE_X86 && (defined(__GNUC__) || defined(__clang__))
+#define OBS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define OBS_TARGET_AVX2
+#endif
+
+using FindEscapeFunction = u64 (*)(const char* data, u64 size);
+
+static bool NeedsEscape(char c)
+{
+    return c == '\\' || c == '"' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/**
+ * Index of the first byte that needs escaping, or size if there is none.
+ */
+static u64 FindEscapeScalar(const char* data, u64 size)
+{
+    for (u64 i = 0; i < size; i++)
+    {
+        if (NeedsEscape(data[i]))
+        {
+            return i;
+        }
+    }
+    return size;
+}
+
+#if OBS_ESCAPE_X86
+
+static u32 CountTrailingZeros(u32 mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<u32>(index);
+#else
+    return static_cast<u32>(__builtin_ctz(mask));
+#endif
+}
+
+static u64 FindEscapeSse2(const char* data, u64 size)
+{
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage_return = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+    u64 i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(chunk, backslash), _mm_cmpeq_epi8(chunk, quote));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, newline));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, carriage_return));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, tab));
+        const u32 mask = static_cast<u32>(_mm_movemask_epi8(matches));
+        if (mask != 0)
+        {
+            return i + CountTrailingZeros(mask);
+        }
+    }
+    return i + FindEscapeScalar(data + i, size - i);
+}
+
+OBS_TARGET_AVX2 static u64 FindEscapeAvx2(const char* data, u64 size)
+{
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriage_return = _mm256_set1_epi8('\r');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    u64 i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i matches = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, backslash), _mm256_cmpeq_epi8(chunk, quote));
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(chunk, newline));
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(chunk, carriage_return));
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(chunk, tab));
+        const u32 mask = static_cast<u32>(_mm256_movemask_epi8(matches));
+        if (mask != 0)
+        {
+            return i + CountTrailingZeros(mask);
+        }
+    }
+    return i + FindEscapeSse2(data + i, size - i);
+}
+
+static bool IsAvx2Supported()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int registers[4] = {};
+    __cpuid(registers, 1);
+    // The OS has to save the AVX registers on context switches, checked through OSXSAVE and XCR0.
+    const bool is_osxsave_enabled = (registers[2] & (1 << 27)) != 0;
+    if (!is_osxsave_enabled || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+    __cpuidex(registers, 7, 0);
+    return (registers[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+bool IsEscapeScannerSupported(EscapeScanner scanner)
+{
+    switch (scanner)
+    {
+        case EscapeScanner::Scalar:
+            return true;
+#if OBS_ESCAPE_X86
+        case EscapeScanner::Sse2:
+            // Part of the baseline of x86-64, all 32-bit targets Obsidian is built for have it as well.
+            return true;
+        case EscapeScanner::Avx2:
+        {
+            static const bool is_supported = IsAvx2Supported();
+            return is_supported;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+EscapeScanner GetBestEscapeScanner()
+{
+    if (IsEscapeScannerSupported(EscapeScanner::Avx2))
+    {
+        return EscapeScanner::Avx2;
+    }
+    if (IsEscapeScannerSupported(EscapeScanner::Sse2))
+    {
+        return EscapeScanner::Sse2;
+    }
+    return EscapeScanner::Scalar;
+}
+
+const char* GetEscapeScannerName(EscapeScanner scanner)
+{
+    switch (scanner)
+    {
+        case EscapeScanner::Scalar:
+            return "scalar";
+        case EscapeScanner::Sse2:
+            return "sse2";
+        case EscapeScanner::Avx2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+static FindEscapeFunction GetFindEscapeFunction([[maybe_unused]] EscapeScanner scanner)
+{
+#if OBS_ESCAPE_X86
+    if (scanner == EscapeScanner::Avx2 && IsEscapeScannerSupported(EscapeScanner::Avx2))
+    {
+        return &FindEscapeAvx2;
+    }
+    if (scanner == EscapeScanner::Sse2 || scanner == EscapeScanner::Avx2)
+    {
+        return &FindEscapeSse2;
+    }
+#endif
+    return &FindEscapeScalar;
+}
+
+static void AppendEscaped(Opal::StringUtf8& out, const char* data, u64 size, FindEscapeFunction find_escape)
+{
+    u64 position = 0;
+    while (position < size)
+    {
+        const u64 run_size = find_escape(data + position, size - position);
+        out.Append(data + position, run_size);
+        position += run_size;
+        if (position == size)
+        {
+            break;
+        }
+        switch (data[position])
+        {
+            case '\\':
+                out.Append("\\\\", 2);
+                break;
+            case '"':
+                out.Append("\\\"", 2);
+                break;
+            case '\n':
+                out.Append("\\n", 2);
+                break;
+            case '\r':
+                out.Append("\\r", 2);
+                break;
+            default:
+                out.Append("\\t", 2);
+                break;
+        }
+        position++;
+    }
+}
+
+void AppendEscapedCppString(Opal::StringUtf8& out, const char* data, u64 size)
+{
+    static const FindEscapeFunction find_escape = GetFindEscapeFunction(GetBestEscapeScanner());
+    AppendEscaped(out, data, size, find_escape);
+}
+
+void AppendEscapedCppString(Opal::StringUtf8& out, const char* data, u64 size, EscapeScanner scanner)
+{
+    AppendEscaped(out, data, size, GetFindEscapeFunction(scanner));
+}
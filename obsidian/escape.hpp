@@ -0,0 +1,25 @@
+#pragma once
+
+#include "types.hpp"
+
+/**
+ * Implementations of the scan for the next character that needs escaping. The fastest one supported by the CPU is picked at
+ * run time, the others are exposed for benchmarking.
+ */
+enum class EscapeScanner : u8
+{
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+[[nodiscard]] bool IsEscapeScannerSupported(EscapeScanner scanner);
+[[nodiscard]] EscapeScanner GetBestEscapeScanner();
+[[nodiscard]] const char* GetEscapeScannerName(EscapeScanner scanner);
+
+/**
+ * Append the bytes escaped for use inside of a C++ string literal. Backslashes, quotes, newlines, carriage returns and tabs
+ * are escaped, runs of other bytes are copied at once.
+ */
+void AppendEscapedCppString(Opal::StringUtf8& out, const char* data, u64 size);
+void AppendEscapedCppString(Opal::StringUtf8& out, const char* data, u64 size, EscapeScanner scanner);
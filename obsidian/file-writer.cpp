@@ -0,0 +1,108 @@
+#include "file-writer.hpp"
+
+#include <cstring>
+
+#include "opal/file-system.h"
+
+#include "system.hpp"
+
+StreamingFileWriter::~StreamingFileWriter()
+{
+    Discard();
+}
+
+bool StreamingFileWriter::Open(const Opal::StringUtf8& file_path)
+{
+    Discard();
+    m_file_path = file_path.Clone();
+    // Process identifier in the name keeps instances that write to the same directory from clobbering each other.
+    m_temp_file_path = Opal::Format("{}.{}.tmp", *file_path, GetProcessIdentifier());
+    // Binary mode so that the file on disk is byte for byte the same as the hashed content.
+    m_file = std::fopen(*m_temp_file_path, "wb");
+    if (m_file == nullptr)
+    {
+        return false;
+    }
+    if (m_buffer.GetSize() != k_buffer_size)
+    {
+        m_buffer.Resize(k_buffer_size);
+    }
+    m_buffer_size = 0;
+    m_written_size = 0;
+    m_hash = HashXXH64Stream();
+    m_has_error = false;
+    return true;
+}
+
+void StreamingFileWriter::Write(const char* data, u64 size)
+{
+    m_hash.Update(data, size);
+    m_written_size += size;
+    if (m_buffer_size + size > k_buffer_size)
+    {
+        Flush();
+        // Data larger than the buffer is written directly instead of being copied in pieces.
+        if (size >= k_buffer_size)
+        {
+            m_has_error = m_has_error || std::fwrite(data, 1, size, m_file) != size;
+            return;
+        }
+    }
+    memcpy(m_buffer.GetData() + m_buffer_size, data, size);
+    m_buffer_size += size;
+}
+
+void StreamingFileWriter::Write(const char* text)
+{
+    Write(text, strlen(text));
+}
+
+void StreamingFileWriter::Flush()
+{
+    if (m_buffer_size > 0)
+    {
+        m_has_error = m_has_error || std::fwrite(m_buffer.GetData(), 1, m_buffer_size, m_file) != m_buffer_size;
+        m_buffer_size = 0;
+    }
+}
+
+StreamingFileWriter::CommitResult StreamingFileWriter::Commit()
+{
+    if (m_file == nullptr)
+    {
+        return CommitResult::Failed;
+    }
+    Flush();
+    const bool is_closed = std::fclose(m_file) == 0;
+    m_file = nullptr;
+    if (m_has_error || !is_closed)
+    {
+        std::remove(*m_temp_file_path);
+        return CommitResult::Failed;
+    }
+
+    // A hash collision between the old and the new content of the same size is not a practical concern, XXH64 is what the
+    // cache relies on to detect changed headers as well.
+    if (Opal::Exists(m_file_path) && GetFileSizeInBytes(m_file_path) == m_written_size
+        && HashFileContents(m_file_path) == m_hash.Digest())
+    {
+        std::remove(*m_temp_file_path);
+        return CommitResult::Unchanged;
+    }
+    if (!RenameFileReplacingExisting(m_temp_file_path, m_file_path))
+    {
+        std::remove(*m_temp_file_path);
+        return CommitResult::Failed;
+    }
+    return CommitResult::Written;
+}
+
+void StreamingFileWriter::Discard()
+{
+    if (m_file != nullptr)
+    {
+        std::fclose(m_file);
+        m_file = nullptr;
+        std::remove(*m_temp_file_path);
+    }
+}
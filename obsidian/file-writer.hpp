@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdio>
+
+#include "types.hpp"
+#include "hash.hpp"
+
+/**
+ * Writes a file through a fixed-size buffer, so content can be streamed to disk as it's produced without holding all of it in
+ * memory. The content goes to a temporary file next to the destination and is hashed while it's written. Commit replaces the
+ * destination only if its content differs, so the modification time of an unchanged file stays the same.
+ */
+class StreamingFileWriter
+{
+public:
+    static constexpr u64 k_buffer_size = 64 * 1024;
+
+    enum class CommitResult : u8
+    {
+        Written,
+        Unchanged,
+        Failed,
+    };
+
+    StreamingFileWriter() = default;
+    /**
+     * Removes the temporary file if the writer wasn't committed.
+     */
+    ~StreamingFileWriter();
+
+    StreamingFileWriter(const StreamingFileWriter&) = delete;
+    StreamingFileWriter& operator=(const StreamingFileWriter&) = delete;
+
+    /**
+     * Start writing the file. Returns false if the temporary file can't be created.
+     */
+    bool Open(const Opal::StringUtf8& file_path);
+
+    void Write(const char* data, u64 size);
+    void Write(const char* text);
+    void Write(const Opal::StringUtf8& text) { Write(text.GetData(), text.GetSize()); }
+
+    /**
+     * Finish writing. The destination is compared with the new content by size and hash, and is only replaced if they differ.
+     */
+    CommitResult Commit();
+
+private:
+    void Flush();
+    void Discard();
+
+    Opal::StringUtf8 m_file_path;
+    Opal::StringUtf8 m_temp_file_path;
+    FILE* m_file = nullptr;
+    Opal::DynamicArray<char> m_buffer;
+    u64 m_buffer_size = 0;
+    u64 m_written_size = 0;
+    HashXXH64Stream m_hash;
+    bool m_has_error = false;
+};
@@ -1,371 +1,935 @@
 #include "generator.hpp"
 #include "types.hpp"
 #include "templates.hpp"
-
+#include "hash.hpp"
+#include "compiled-template.hpp"
+#include "allocators.hpp"
+#include "escape.hpp"
+#include "file-writer.hpp"
+#include "perfect-hash.hpp"
+
+#include <atomic>
 #include <cstdio>
 #include <cstring>
 
 #include "opal/file-system.h"
 #include "opal/logging.h"
 #include "opal/paths.h"
+#include "opal/threading/thread-pool.h"
+#include "opal/time.h"
 
-static Opal::StringUtf8 ReplaceAll(const Opal::StringUtf8& source, const char* placeholder, const Opal::StringUtf8& replacement)
+static void AppendInt(Opal::StringUtf8& out, Opal::i64 value)
 {
-    Opal::StringUtf8 result = source.Clone();
-    const Opal::u64 placeholder_len = strlen(placeholder);
-    Opal::u64 pos = Opal::Find<Opal::StringUtf8>(result, placeholder);
-    while (pos != Opal::StringUtf8::k_npos)
-    {
-        Opal::StringUtf8 prefix = std::move(Opal::GetSubString(result, 0, pos).GetValue());
-        Opal::StringUtf8 suffix;
-        if (pos + placeholder_len < result.GetSize())
-        {
-            suffix = std::move(Opal::GetSubString(result, pos + placeholder_len).GetValue());
-        }
-        result = prefix + replacement + suffix;
-        pos = Opal::Find<Opal::StringUtf8>(result, placeholder, pos + replacement.GetSize());
+    char buffer[32];
+    const int size = snprintf(buffer, sizeof(buffer), "%lld", value);
+    out.Append(buffer, static_cast<Opal::u64>(size));
+}
+
+/**
+ * Start writing a reflection file, see CommitReflectionFile.
+ */
+static void OpenReflectionFile(StreamingFileWriter& writer, const Opal::StringUtf8& path)
+{
+    if (!writer.Open(path))
+    {
+        throw FileWriteException(path);
     }
-    return result;
 }
 
-static Opal::StringUtf8 IntToString(Opal::i64 value)
+/**
+ * Finish writing a reflection file. The file is only replaced if its content changed, rewriting an identical file would update
+ * its modification time and build systems would recompile everything that includes it. The normalized path is added to
+ * generated_files.
+ */
+static void CommitReflectionFile(StreamingFileWriter& writer, const Opal::StringUtf8& path,
+                                 Opal::DynamicArray<Opal::StringUtf8>& generated_files)
 {
-    char buffer[32];
-    snprintf(buffer, sizeof(buffer), "%lld", value);
-    return Opal::StringUtf8(buffer);
+    switch (writer.Commit())
+    {
+        case StreamingFileWriter::CommitResult::Written:
+            Opal::GetLogger().Info("Obsidian", "Wrote reflection file: {}", path.GetData());
+            break;
+        case StreamingFileWriter::CommitResult::Unchanged:
+            Opal::GetLogger().Info("Obsidian", "Reflection file unchanged: {}", path.GetData());
+            break;
+        case StreamingFileWriter::CommitResult::Failed:
+            throw FileWriteException(path);
+    }
+    generated_files.PushBack(Opal::Paths::NormalizePath(path));
 }
 
-static bool WriteToFile(const Opal::StringUtf8& path, const Opal::StringUtf8& content)
+static void AppendEscaped(Opal::StringUtf8& out, const Opal::StringUtf8& input)
 {
-    FILE* file = fopen(path.GetData(), "w");
-    if (file == nullptr)
+    AppendEscapedCppString(out, input.GetData(), input.GetSize());
+}
+
+static void AppendQualifiedConstantName(Opal::StringUtf8& out, const CppEnum& cpp_enum, const CppEnumConstant& constant)
+{
+    if (cpp_enum.is_enum_class)
+    {
+        out += cpp_enum.full_name;
+        out += "::";
+    }
+    else if (!cpp_enum.scope.IsEmpty())
     {
-        return false;
+        out += cpp_enum.scope;
+        out += "::";
     }
-    const Opal::u64 written = fwrite(content.GetData(), 1, content.GetSize(), file);
-    fclose(file);
-    return written == content.GetSize();
+    out += constant.name;
 }
 
-static Opal::StringUtf8 EscapeCppStringLiteral(const Opal::StringUtf8& input)
+static void AppendAttributeList(Opal::StringUtf8& out, const Opal::DynamicArray<CppAttribute>& attributes)
 {
-    Opal::StringUtf8 result;
-    const char* data = input.GetData();
-    const Opal::u64 size = input.GetSize();
-    for (Opal::u64 i = 0; i < size; i++)
+    for (Opal::u64 i = 0; i < attributes.GetSize(); i++)
     {
-        switch (data[i])
+        if (i > 0)
         {
-            case '\\':
-                result += "\\\\";
-                break;
-            case '"':
-                result += "\\\"";
-                break;
-            case '\n':
-                result += "\\n";
-                break;
-            case '\r':
-                result += "\\r";
-                break;
-            case '\t':
-                result += "\\t";
-                break;
-            default:
-                result += Opal::StringUtf8(&data[i], 1);
-                break;
+            out += ", ";
         }
+        out += "{\"";
+        AppendEscaped(out, attributes[i].name);
+        out += "\", \"";
+        AppendEscaped(out, attributes[i].value);
+        out += "\"}";
     }
-    return result;
 }
 
-static Opal::StringUtf8 QualifiedConstantName(const CppEnum& cpp_enum, const CppEnumConstant& constant)
+/**
+ * Append a constexpr table named `name` holding `count` comma separated `elements`, followed by a Span over it. Empty tables
+ * only get an empty Span since C++ doesn't allow zero sized arrays.
+ */
+static void AppendSpan(Opal::StringUtf8& out, const char* element_type, const char* name, const Opal::StringUtf8& elements,
+                       Opal::u64 count)
 {
-    if (cpp_enum.is_enum_class)
-    {
-        return cpp_enum.full_name + "::" + constant.name;
-    }
-    if (!cpp_enum.scope.IsEmpty())
+    if (count == 0)
     {
-        return cpp_enum.scope + "::" + constant.name;
+        out += "    static constexpr Span<";
+        out += element_type;
+        out += "> ";
+        out += name;
+        out += " = {};\n";
+        return;
     }
-    return constant.name.Clone();
+    out += "    static constexpr ";
+    out += element_type;
+    out += " ";
+    out += name;
+    out += "_array[] = {";
+    out += elements;
+    out += "};\n    static constexpr Span<";
+    out += element_type;
+    out += "> ";
+    out += name;
+    out += " = {";
+    out += name;
+    out += "_array, ";
+    AppendInt(out, static_cast<Opal::i64>(count));
+    out += "};\n";
 }
 
-static Opal::StringUtf8 GenerateAttributeList(const Opal::DynamicArray<CppAttribute>& attributes)
+static void AppendIntList(Opal::StringUtf8& out, const Opal::DynamicArray<Opal::u32>& values)
 {
-    Opal::StringUtf8 result;
-    for (Opal::u64 i = 0; i < attributes.GetSize(); i++)
+    for (Opal::u64 i = 0; i < values.GetSize(); i++)
     {
         if (i > 0)
         {
-            result += ", ";
+            out += ", ";
         }
-        result += "{\"" + EscapeCppStringLiteral(attributes[i].name) + "\", \"" + EscapeCppStringLiteral(attributes[i].value) + "\"}";
+        AppendInt(out, values[i]);
     }
+}
+
+/**
+ * Append a NameIndex named `name` with the perfect hash of the given names, see Impl::FindByName.
+ */
+static void AppendNameIndex(Opal::StringUtf8& out, const char* name, const Opal::DynamicArray<const Opal::StringUtf8*>& names,
+                            ArenaAllocator& arena)
+{
+    const PerfectHash hash = BuildPerfectHash(names);
+
+    Opal::StringUtf8 displacements_name(&arena);
+    displacements_name += name;
+    displacements_name += "_displacements";
+    Opal::StringUtf8 displacements(&arena);
+    AppendIntList(displacements, hash.displacements);
+    AppendSpan(out, "uint32_t", displacements_name.GetData(), displacements, hash.displacements.GetSize());
+
+    Opal::StringUtf8 slots_name(&arena);
+    slots_name += name;
+    slots_name += "_slots";
+    Opal::StringUtf8 slots(&arena);
+    AppendIntList(slots, hash.slots);
+    AppendSpan(out, "uint32_t", slots_name.GetData(), slots, hash.slots.GetSize());
+
+    out += "    static constexpr NameIndex ";
+    out += name;
+    out += " = {";
+    AppendInt(out, static_cast<Opal::i64>(hash.seed));
+    out += ", ";
+    out += displacements_name;
+    out += ", ";
+    out += slots_name;
+    out += "};\n";
+}
+
+static Opal::StringUtf8 EscapedString(const Opal::StringUtf8& input, ArenaAllocator& arena)
+{
+    Opal::StringUtf8 result(&arena);
+    AppendEscaped(result, input);
     return result;
 }
 
-static Opal::StringUtf8 GenerateEnumSpecialization(const CppEnum& cpp_enum)
+/**
+ * Templates used by the generator, split into segments once per run and shared by all workers.
+ */
+struct GeneratorTemplates
+{
+    CompiledTemplate enum_specialization{ObsTemplates::k_enum_template,
+                                         {"__enum_full_name__", "__enum_name__", "__enum_scope__", "__enum_comment__",
+                                          "__enum_last_entry__", "__enum_value_to_description_switch__", "__enum_value_to_name_switch__",
+                                          "__enum_name_to_value_switch__", "__enum_tables__"}};
+    CompiledTemplate class_specialization{ObsTemplates::k_class_template,
+                                          {"__class_scoped_name__", "__class_name__", "__class_scope__", "__class_description__",
+                                           "__class_tables__"}};
+    CompiledTemplate enum_collection{ObsTemplates::k_enum_collection_template, {"__enum_collection_entries__"}};
+    CompiledTemplate class_collection{ObsTemplates::k_class_collection_template, {"__class_collection_entries__"}};
+    CompiledTemplate reflection_header{ObsTemplates::k_reflection_header_template,
+                                       {"__refl_includes__", "__refl_definitions__", "__refl_enum__", "__refl_class__",
+                                        "__refl_enum_collection__", "__refl_class_collection__"}};
+    CompiledTemplate reflection_core{ObsTemplates::k_reflection_core_template, {"__refl_definitions__"}};
+    CompiledTemplate reflection_file{ObsTemplates::k_reflection_file_template, {"__refl_includes__", "__refl_enum__", "__refl_class__"}};
+    CompiledTemplate reflection_aggregate{ObsTemplates::k_reflection_aggregate_template,
+                                          {"__refl_includes__", "__refl_enum_collection__", "__refl_class_collection__"}};
+};
+
+/**
+ * Arenas used by the generator, one per worker so that allocations don't need locking. All generated code and the temporary
+ * strings used to build it are allocated from them and released at once when generation is done.
+ */
+class GeneratorArenas
 {
-    Opal::StringUtf8 result = ObsTemplates::k_enum_template;
+public:
+    explicit GeneratorArenas(Opal::u64 count)
+    {
+        for (Opal::u64 i = 0; i < count; i++)
+        {
+            m_arenas.PushBack(Opal::New<ArenaAllocator>(Opal::GetDefaultAllocator()));
+        }
+    }
 
-    result = ReplaceAll(result, "__enum_full_name__", EscapeCppStringLiteral(cpp_enum.full_name));
-    result = ReplaceAll(result, "__enum_name__", EscapeCppStringLiteral(cpp_enum.name));
-    result = ReplaceAll(result, "__enum_scope__", EscapeCppStringLiteral(cpp_enum.scope));
-    result = ReplaceAll(result, "__enum_comment__", EscapeCppStringLiteral(cpp_enum.description));
+    ~GeneratorArenas()
+    {
+        for (ArenaAllocator* arena : m_arenas)
+        {
+            Opal::Delete(Opal::GetDefaultAllocator(), arena);
+        }
+    }
+
+    GeneratorArenas(const GeneratorArenas&) = delete;
+    GeneratorArenas& operator=(const GeneratorArenas&) = delete;
+
+    [[nodiscard]] Opal::u64 GetCount() const { return m_arenas.GetSize(); }
+    [[nodiscard]] ArenaAllocator& operator[](Opal::u64 index) { return *m_arenas[index]; }
+
+    [[nodiscard]] AllocationStats GetStats() const
+    {
+        AllocationStats stats;
+        for (const ArenaAllocator* arena : m_arenas)
+        {
+            stats.allocation_count += arena->GetStats().allocation_count;
+            stats.allocated_bytes += arena->GetStats().allocated_bytes;
+        }
+        return stats;
+    }
+
+private:
+    Opal::DynamicArray<ArenaAllocator*> m_arenas;
+};
+
+static Opal::StringUtf8 GenerateEnumSpecialization(const GeneratorTemplates& templates, const CppEnum& cpp_enum, ArenaAllocator& arena)
+{
+    const Opal::StringUtf8 full_name = EscapedString(cpp_enum.full_name, arena);
+    const Opal::StringUtf8 name = EscapedString(cpp_enum.name, arena);
+    const Opal::StringUtf8 scope = EscapedString(cpp_enum.scope, arena);
+    const Opal::StringUtf8 comment = EscapedString(cpp_enum.description, arena);
 
     // Last entry
+    Opal::StringUtf8 last_entry(&arena);
     if (!cpp_enum.constants.IsEmpty())
     {
         const CppEnumConstant& last = cpp_enum.constants[cpp_enum.constants.GetSize() - 1];
-        result = ReplaceAll(result, "__enum_last_entry__", QualifiedConstantName(cpp_enum, last));
+        AppendQualifiedConstantName(last_entry, cpp_enum, last);
     }
     else
     {
-        result = ReplaceAll(result, "__enum_last_entry__", "-1");
+        last_entry += "-1";
     }
 
     // Value to description switch
-    Opal::StringUtf8 desc_switch;
+    Opal::StringUtf8 desc_switch(&arena);
     for (Opal::u64 i = 0; i < cpp_enum.constants.GetSize(); i++)
     {
         if (i > 0)
         {
             desc_switch += "\n";
         }
-        desc_switch += "            case " + QualifiedConstantName(cpp_enum, cpp_enum.constants[i]) + ": return \""
-                       + EscapeCppStringLiteral(cpp_enum.constants[i].description) + "\";";
+        desc_switch += "            case ";
+        AppendQualifiedConstantName(desc_switch, cpp_enum, cpp_enum.constants[i]);
+        desc_switch += ": return \"";
+        AppendEscaped(desc_switch, cpp_enum.constants[i].description);
+        desc_switch += "\";";
     }
-    result = ReplaceAll(result, "__enum_value_to_description_switch__", desc_switch);
 
     // Value to name switch
-    Opal::StringUtf8 name_switch;
+    Opal::StringUtf8 name_switch(&arena);
     for (Opal::u64 i = 0; i < cpp_enum.constants.GetSize(); i++)
     {
         if (i > 0)
         {
             name_switch += "\n";
         }
-        name_switch += "            case " + QualifiedConstantName(cpp_enum, cpp_enum.constants[i]) + ": return \""
-                       + EscapeCppStringLiteral(cpp_enum.constants[i].name) + "\";";
+        name_switch += "            case ";
+        AppendQualifiedConstantName(name_switch, cpp_enum, cpp_enum.constants[i]);
+        name_switch += ": return \"";
+        AppendEscaped(name_switch, cpp_enum.constants[i].name);
+        name_switch += "\";";
     }
-    result = ReplaceAll(result, "__enum_value_to_name_switch__", name_switch);
 
     // Name to value switch
-    Opal::StringUtf8 name_to_value;
+    Opal::StringUtf8 name_to_value(&arena);
     for (Opal::u64 i = 0; i < cpp_enum.constants.GetSize(); i++)
     {
         if (i > 0)
         {
             name_to_value += "\n";
         }
-        name_to_value += "        if (strcmp(name, \"" + EscapeCppStringLiteral(cpp_enum.constants[i].name) + "\") == 0) return "
-                         + QualifiedConstantName(cpp_enum, cpp_enum.constants[i]) + ";";
+        name_to_value += "        if (strcmp(name, \"";
+        AppendEscaped(name_to_value, cpp_enum.constants[i].name);
+        name_to_value += "\") == 0) return ";
+        AppendQualifiedConstantName(name_to_value, cpp_enum, cpp_enum.constants[i]);
+        name_to_value += ";";
     }
-    result = ReplaceAll(result, "__enum_name_to_value_switch__", name_to_value);
 
-    // Attributes
-    result = ReplaceAll(result, "__enum_attributes__", GenerateAttributeList(cpp_enum.attributes));
+    // Items and attributes tables
+    Opal::StringUtf8 items(&arena);
+    for (Opal::u64 i = 0; i < cpp_enum.constants.GetSize(); i++)
+    {
+        const CppEnumConstant& constant = cpp_enum.constants[i];
+        if (i > 0)
+        {
+            items += ", ";
+        }
+        items += "{\"";
+        AppendEscaped(items, constant.name);
+        items += "\", \"";
+        AppendEscaped(items, constant.description);
+        items += "\", ";
+        if (constant.value < 0)
+        {
+            items += "static_cast<uint64_t>(";
+            AppendInt(items, constant.value);
+            items += "LL)";
+        }
+        else
+        {
+            AppendInt(items, constant.value);
+        }
+        items += "}";
+    }
+    Opal::StringUtf8 attributes(&arena);
+    AppendAttributeList(attributes, cpp_enum.attributes);
+
+    Opal::StringUtf8 tables(&arena);
+    AppendSpan(tables, "EnumItem", "k_items", items, cpp_enum.constants.GetSize());
+    Opal::DynamicArray<const Opal::StringUtf8*> item_names(&arena);
+    for (const CppEnumConstant& constant : cpp_enum.constants)
+    {
+        item_names.PushBack(&constant.name);
+    }
+    AppendNameIndex(tables, "k_item_index", item_names, arena);
+    AppendSpan(tables, "Attribute", "k_attributes", attributes, cpp_enum.attributes.GetSize());
 
+    Opal::StringUtf8 result(&arena);
+    templates.enum_specialization.Render(
+        result, {&full_name, &name, &scope, &comment, &last_entry, &desc_switch, &name_switch, &name_to_value, &tables});
     return result;
 }
 
-static Opal::StringUtf8 GenerateClassSpecialization(const CppClass& cpp_class)
+/**
+ * Append the initializer of a Property. Its attributes are referenced through the Span named `attributes_name`.
+ */
+static void AppendPropertyInitializer(Opal::StringUtf8& out, const CppClass& cpp_class, const CppProperty& prop,
+                                      const Opal::StringUtf8& attributes_name)
 {
-    Opal::StringUtf8 result = ObsTemplates::k_class_template;
-
-    result = ReplaceAll(result, "__class_scoped_name__", EscapeCppStringLiteral(cpp_class.full_name));
-    result = ReplaceAll(result, "__class_name__", EscapeCppStringLiteral(cpp_class.name));
-    result = ReplaceAll(result, "__class_scope__", EscapeCppStringLiteral(cpp_class.scope));
-    result = ReplaceAll(result, "__class_description__", EscapeCppStringLiteral(cpp_class.description));
+    out += "{\"";
+    AppendEscaped(out, prop.name);
+    out += "\", \"";
+    AppendEscaped(out, prop.description);
+    out += "\", \"";
+    AppendEscaped(out, prop.type);
+    out += "\", ";
+    out += prop.is_pod ? "true" : "false";
+    // Offset
+    out += ", offsetof(";
+    out += cpp_class.full_name;
+    out += ", ";
+    out += prop.name;
+    // Size
+    out += "), sizeof(std::declval<";
+    out += prop.full_type;
+    // Read lambda
+    out += ">()), [](const void* obj, void* out) { *static_cast<decltype(";
+    out += cpp_class.full_name;
+    out += "::";
+    out += prop.name;
+    out += ")*>(out) = static_cast<const ";
+    out += cpp_class.full_name;
+    out += "*>(obj)->";
+    out += prop.name;
+    // Write lambda
+    out += "; }, [](void* obj, const void* in) { static_cast<";
+    out += cpp_class.full_name;
+    out += "*>(obj)->";
+    out += prop.name;
+    out += " = *static_cast<const decltype(";
+    out += cpp_class.full_name;
+    out += "::";
+    out += prop.name;
+    out += ")*>(in); }, ";
+    out += attributes_name;
+    out += "}";
+}
 
-    // Init properties
-    Opal::StringUtf8 properties = "{";
+static Opal::StringUtf8 GenerateClassSpecialization(const GeneratorTemplates& templates, const CppClass& cpp_class, ArenaAllocator& arena)
+{
+    const Opal::StringUtf8 scoped_name = EscapedString(cpp_class.full_name, arena);
+    const Opal::StringUtf8 name = EscapedString(cpp_class.name, arena);
+    const Opal::StringUtf8 scope = EscapedString(cpp_class.scope, arena);
+    const Opal::StringUtf8 description = EscapedString(cpp_class.description, arena);
+
+    // Attributes of the class and of every property, then the properties that reference them
+    Opal::StringUtf8 tables(&arena);
+    Opal::StringUtf8 attributes(&arena);
+    AppendAttributeList(attributes, cpp_class.attributes);
+    AppendSpan(tables, "Attribute", "k_attributes", attributes, cpp_class.attributes.GetSize());
+
+    Opal::StringUtf8 properties(&arena);
     for (Opal::u64 i = 0; i < cpp_class.properties.GetSize(); i++)
     {
         const CppProperty& prop = cpp_class.properties[i];
+        Opal::StringUtf8 property_attributes_name(&arena);
+        property_attributes_name += "k_property_";
+        AppendInt(property_attributes_name, static_cast<Opal::i64>(i));
+        property_attributes_name += "_attributes";
+
+        Opal::StringUtf8 property_attributes(&arena);
+        AppendAttributeList(property_attributes, prop.attributes);
+        AppendSpan(tables, "Attribute", property_attributes_name.GetData(), property_attributes, prop.attributes.GetSize());
+
         if (i > 0)
         {
             properties += ", ";
         }
-        Opal::StringUtf8 is_pod_str = prop.is_pod ? "true" : "false";
-        Opal::StringUtf8 offset_expr = "offsetof(" + cpp_class.full_name + ", " + prop.name + ")";
-        Opal::StringUtf8 size_expr = "sizeof(std::declval<" + prop.full_type + ">())";
-        Opal::StringUtf8 member_type = "decltype(" + cpp_class.full_name + "::" + prop.name + ")";
-        Opal::StringUtf8 read_lambda = "[](const void* obj, void* out) { *static_cast<" + member_type
-                                        + "*>(out) = static_cast<const " + cpp_class.full_name + "*>(obj)->" + prop.name + "; }";
-        Opal::StringUtf8 write_lambda = "[](void* obj, const void* in) { static_cast<" + cpp_class.full_name
-                                         + "*>(obj)->" + prop.name + " = *static_cast<const " + member_type + "*>(in); }";
-        Opal::StringUtf8 prop_attrs = "{" + GenerateAttributeList(prop.attributes) + "}";
-        properties += "{\"" + EscapeCppStringLiteral(prop.name) + "\", \"" + EscapeCppStringLiteral(prop.description) + "\", \""
-                      + EscapeCppStringLiteral(prop.type) + "\", " + is_pod_str + ", " + offset_expr + ", " + size_expr + ", "
-                      + read_lambda + ", " + write_lambda + ", " + prop_attrs + "}";
-    }
-    properties += "}";
-    result = ReplaceAll(result, "__class_init_properties__", properties);
-
-    // Attributes
-    result = ReplaceAll(result, "__class_attributes__", GenerateAttributeList(cpp_class.attributes));
+        AppendPropertyInitializer(properties, cpp_class, prop, property_attributes_name);
+    }
+    AppendSpan(tables, "Property", "k_properties", properties, cpp_class.properties.GetSize());
+    Opal::DynamicArray<const Opal::StringUtf8*> property_names(&arena);
+    for (const CppProperty& prop : cpp_class.properties)
+    {
+        property_names.PushBack(&prop.name);
+    }
+    AppendNameIndex(tables, "k_property_index", property_names, arena);
 
+    Opal::StringUtf8 result(&arena);
+    templates.class_specialization.Render(result, {&scoped_name, &name, &scope, &description, &tables});
     return result;
 }
 
-static Opal::StringUtf8 GenerateEnumCollection(const Opal::DynamicArray<CppEnum>& enums)
+static Opal::StringUtf8 GenerateEnumCollection(const GeneratorTemplates& templates, const Opal::DynamicArray<CppEnum>& enums,
+                                               ArenaAllocator& arena)
 {
-    Opal::StringUtf8 result = ObsTemplates::k_enum_collection_template;
-
-    Opal::StringUtf8 entries = "{\n";
+    // Items and attributes are referenced from the tables of the specializations instead of being copied.
+    Opal::StringUtf8 entries(&arena);
     for (Opal::u64 i = 0; i < enums.GetSize(); i++)
     {
         const CppEnum& cpp_enum = enums[i];
         if (i > 0)
         {
-            entries += ",\n";
+            entries += ",";
         }
-        entries += "        {\"" + EscapeCppStringLiteral(cpp_enum.name) + "\", \"" + EscapeCppStringLiteral(cpp_enum.full_name)
-                   + "\", \"" + EscapeCppStringLiteral(cpp_enum.description) + "\", " + IntToString(cpp_enum.underlying_type_size) + ", {";
+        entries += "\n        {\"";
+        AppendEscaped(entries, cpp_enum.name);
+        entries += "\", \"";
+        AppendEscaped(entries, cpp_enum.full_name);
+        entries += "\", \"";
+        AppendEscaped(entries, cpp_enum.description);
+        entries += "\", ";
+        AppendInt(entries, cpp_enum.underlying_type_size);
+        entries += ", Enum<";
+        entries += cpp_enum.full_name;
+        entries += ">::GetItems(), Enum<";
+        entries += cpp_enum.full_name;
+        entries += ">::GetAttributes(), Enum<";
+        entries += cpp_enum.full_name;
+        entries += ">::GetItemIndex()}";
+    }
+    if (!enums.IsEmpty())
+    {
+        entries += "\n    ";
+    }
 
-        for (Opal::u64 j = 0; j < cpp_enum.constants.GetSize(); j++)
-        {
-            const CppEnumConstant& constant = cpp_enum.constants[j];
-            if (j > 0)
-            {
-                entries += ", ";
-            }
-
-            Opal::StringUtf8 value_str;
-            if (constant.value < 0)
-            {
-                value_str = "static_cast<uint64_t>(" + IntToString(constant.value) + "LL)";
-            }
-            else
-            {
-                value_str = IntToString(constant.value);
-            }
-            entries += "{\"" + EscapeCppStringLiteral(constant.name) + "\", \"" + EscapeCppStringLiteral(constant.description) + "\", "
-                       + value_str + "}";
-        }
-        entries += "}, {" + GenerateAttributeList(cpp_enum.attributes) + "}}";
+    Opal::StringUtf8 tables(&arena);
+    AppendSpan(tables, "EnumEntry", "k_entries", entries, enums.GetSize());
+    Opal::DynamicArray<const Opal::StringUtf8*> enum_names(&arena);
+    for (const CppEnum& cpp_enum : enums)
+    {
+        enum_names.PushBack(&cpp_enum.name);
     }
-    entries += "\n    }";
+    AppendNameIndex(tables, "k_index", enum_names, arena);
 
-    result = ReplaceAll(result, "__enum_collection_entries__", entries);
+    Opal::StringUtf8 result(&arena);
+    templates.enum_collection.Render(result, {&tables});
     return result;
 }
 
-static Opal::StringUtf8 GenerateClassCollection(const Opal::DynamicArray<CppClass>& classes)
+static Opal::StringUtf8 GenerateClassCollection(const GeneratorTemplates& templates, const Opal::DynamicArray<CppClass>& classes,
+                                                ArenaAllocator& arena)
 {
-    Opal::StringUtf8 result = ObsTemplates::k_class_collection_template;
-
-    Opal::StringUtf8 entries = "{\n";
+    // Properties and attributes are referenced from the tables of the specializations instead of being copied.
+    Opal::StringUtf8 entries(&arena);
     for (Opal::u64 i = 0; i < classes.GetSize(); i++)
     {
         const CppClass& cpp_class = classes[i];
         if (i > 0)
         {
-            entries += ",\n";
+            entries += ",";
         }
-        Opal::StringUtf8 create_lambda = "[](Opal::AllocatorBase* allocator) -> void* { return Opal::New<" + cpp_class.full_name + ">(allocator); }";
-        entries += "        {\"" + EscapeCppStringLiteral(cpp_class.name) + "\", \"" + EscapeCppStringLiteral(cpp_class.scope) + "\", \""
-                   + EscapeCppStringLiteral(cpp_class.full_name) + "\", \"" + EscapeCppStringLiteral(cpp_class.description) + "\", sizeof("
-                   + cpp_class.full_name + "), alignof(" + cpp_class.full_name + "), " + create_lambda + ", {";
+        entries += "\n        {\"";
+        AppendEscaped(entries, cpp_class.name);
+        entries += "\", \"";
+        AppendEscaped(entries, cpp_class.scope);
+        entries += "\", \"";
+        AppendEscaped(entries, cpp_class.full_name);
+        entries += "\", \"";
+        AppendEscaped(entries, cpp_class.description);
+        entries += "\", sizeof(";
+        entries += cpp_class.full_name;
+        entries += "), alignof(";
+        entries += cpp_class.full_name;
+        entries += "), [](Opal::AllocatorBase* allocator) -> void* { return Opal::New<";
+        entries += cpp_class.full_name;
+        entries += ">(allocator); }, Class<";
+        entries += cpp_class.full_name;
+        entries += ">::GetProperties(), Class<";
+        entries += cpp_class.full_name;
+        entries += ">::GetAttributes(), Class<";
+        entries += cpp_class.full_name;
+        entries += ">::GetPropertyIndex()}";
+    }
+    if (!classes.IsEmpty())
+    {
+        entries += "\n    ";
+    }
 
-        for (Opal::u64 j = 0; j < cpp_class.properties.GetSize(); j++)
+    Opal::StringUtf8 tables(&arena);
+    AppendSpan(tables, "ClassEntry", "k_entries", entries, classes.GetSize());
+    Opal::DynamicArray<const Opal::StringUtf8*> class_names(&arena);
+    for (const CppClass& cpp_class : classes)
+    {
+        class_names.PushBack(&cpp_class.name);
+    }
+    AppendNameIndex(tables, "k_index", class_names, arena);
+
+    Opal::StringUtf8 result(&arena);
+    templates.class_collection.Render(result, {&tables});
+    return result;
+}
+
+static Opal::StringUtf8 GenerateIncludes(const Opal::DynamicArray<Opal::StringUtf8>& paths, ArenaAllocator& arena)
+{
+    Opal::StringUtf8 includes(&arena);
+    for (const auto& path : paths)
+    {
+        if (!includes.IsEmpty())
         {
-            const CppProperty& prop = cpp_class.properties[j];
-            if (j > 0)
-            {
-                entries += ", ";
-            }
-            Opal::StringUtf8 is_pod_str = prop.is_pod ? "true" : "false";
-            Opal::StringUtf8 offset_expr = "offsetof(" + cpp_class.full_name + ", " + prop.name + ")";
-            Opal::StringUtf8 size_expr = "sizeof(std::declval<" + prop.full_type + ">())";
-            Opal::StringUtf8 member_type = "decltype(" + cpp_class.full_name + "::" + prop.name + ")";
-            Opal::StringUtf8 read_lambda = "[](const void* obj, void* out) { *static_cast<" + member_type
-                                            + "*>(out) = static_cast<const " + cpp_class.full_name + "*>(obj)->" + prop.name + "; }";
-            Opal::StringUtf8 write_lambda = "[](void* obj, const void* in) { static_cast<" + cpp_class.full_name
-                                             + "*>(obj)->" + prop.name + " = *static_cast<const " + member_type + "*>(in); }";
-            Opal::StringUtf8 prop_attrs = "{" + GenerateAttributeList(prop.attributes) + "}";
-            entries += "{\"" + EscapeCppStringLiteral(prop.name) + "\", \"" + EscapeCppStringLiteral(prop.description) + "\", \""
-                       + EscapeCppStringLiteral(prop.type) + "\", " + is_pod_str + ", " + offset_expr + ", " + size_expr + ", "
-                       + read_lambda + ", " + write_lambda + ", " + prop_attrs + "}";
+            includes += "\n";
         }
-        entries += "}, {" + GenerateAttributeList(cpp_class.attributes) + "}}";
+        includes += "#include \"";
+        AppendEscaped(includes, path);
+        includes += "\"";
     }
-    entries += "\n    }";
+    return includes;
+}
 
-    result = ReplaceAll(result, "__class_collection_entries__", entries);
-    return result;
+/**
+ * Generated code of every type, in the same order as the types in the context.
+ */
+struct GeneratedCode
+{
+    Opal::DynamicArray<Opal::StringUtf8> enum_specializations;
+    Opal::DynamicArray<Opal::StringUtf8> class_specializations;
+    Opal::StringUtf8 enum_collection;
+    Opal::StringUtf8 class_collection;
+};
+
+/**
+ * Generate specializations of all types and both collections using one worker thread per arena. Every type is generated
+ * into its own buffer, so the output is the same no matter how many workers there are or in which order they finish.
+ */
+static GeneratedCode GenerateCodeParallel(const GeneratorTemplates& templates, const CppContext& context, GeneratorArenas& arenas,
+                                          ParallelPhaseStats& stats)
+{
+    const Opal::f64 start_time = Opal::GetSeconds();
+    GeneratedCode code;
+    const Opal::u64 enum_count = context.enums.GetSize();
+    const Opal::u64 class_count = context.classes.GetSize();
+    for (Opal::u64 i = 0; i < enum_count; i++)
+    {
+        code.enum_specializations.PushBack(Opal::StringUtf8());
+    }
+    for (Opal::u64 i = 0; i < class_count; i++)
+    {
+        code.class_specializations.PushBack(Opal::StringUtf8());
+    }
+
+    // Work items are enums, then classes, then the two collections.
+    const Opal::u64 item_count = enum_count + class_count + 2;
+    // Every item is generated by exactly one worker, so workers can write durations without synchronization.
+    Opal::DynamicArray<Opal::f64> durations;
+    durations.Resize(item_count);
+    const auto generate_item = [&templates, &context, &code, &durations, enum_count, class_count](Opal::u64 index, ArenaAllocator& arena)
+    {
+        const Opal::f64 item_start_time = Opal::GetSeconds();
+        if (index < enum_count)
+        {
+            code.enum_specializations[index] = GenerateEnumSpecialization(templates, context.enums[index], arena);
+        }
+        else if (index < enum_count + class_count)
+        {
+            code.class_specializations[index - enum_count] =
+                GenerateClassSpecialization(templates, context.classes[index - enum_count], arena);
+        }
+        else if (index == enum_count + class_count)
+        {
+            code.enum_collection = GenerateEnumCollection(templates, context.enums, arena);
+        }
+        else
+        {
+            code.class_collection = GenerateClassCollection(templates, context.classes, arena);
+        }
+        durations[index] = Opal::GetSeconds() - item_start_time;
+    };
+
+    const Opal::u64 worker_count = arenas.GetCount();
+    if (worker_count == 1)
+    {
+        for (Opal::u64 i = 0; i < item_count; i++)
+        {
+            generate_item(i, arenas[0]);
+        }
+    }
+    else
+    {
+        Opal::ThreadPool thread_pool(static_cast<Opal::i32>(worker_count), 128);
+        std::atomic<Opal::u64> next_item_index = 0;
+        Opal::DynamicArray<Opal::SharedPtr<Opal::Task>> tasks;
+        for (Opal::u64 i = 0; i < worker_count; i++)
+        {
+            ArenaAllocator& arena = arenas[i];
+            tasks.PushBack(thread_pool.AddFunctionTask(
+                [&generate_item, &next_item_index, &arena, item_count](Opal::Task::TransmitterType& transmitter)
+                {
+                    for (Opal::u64 index = next_item_index.fetch_add(1); index < item_count; index = next_item_index.fetch_add(1))
+                    {
+                        generate_item(index, arena);
+                    }
+                }));
+        }
+        for (auto& task : tasks)
+        {
+            task->WaitForCompletion();
+        }
+    }
+
+    stats.worker_count = static_cast<Opal::u32>(worker_count);
+    stats.duration = static_cast<Opal::f32>(Opal::GetSeconds() - start_time);
+    for (Opal::u64 i = 0; i < enum_count; i++)
+    {
+        stats.AddItem(durations[i], context.enums[i].full_name);
+    }
+    for (Opal::u64 i = 0; i < class_count; i++)
+    {
+        stats.AddItem(durations[enum_count + i], context.classes[i].full_name);
+    }
+    stats.AddItem(durations[enum_count + class_count], "enum collection");
+    stats.AddItem(durations[enum_count + class_count + 1], "class collection");
+    return code;
 }
 
-static Opal::StringUtf8 GenerateSingleFile(const CppContext& context)
+static void WriteSpecializations(StreamingFileWriter& writer, const Opal::DynamicArray<const Opal::StringUtf8*>& specializations)
 {
-    Opal::StringUtf8 result = ObsTemplates::k_reflection_header_template;
+    for (Opal::u64 i = 0; i < specializations.GetSize(); i++)
+    {
+        writer.Write(*specializations[i]);
+        if (i + 1 < specializations.GetSize())
+        {
+            writer.Write("\n", 1);
+        }
+    }
+}
 
+static Opal::DynamicArray<const Opal::StringUtf8*> GetAll(const Opal::DynamicArray<Opal::StringUtf8>& specializations)
+{
+    Opal::DynamicArray<const Opal::StringUtf8*> result;
+    result.Reserve(specializations.GetSize());
+    for (const auto& specialization : specializations)
+    {
+        result.PushBack(&specialization);
+    }
+    return result;
+}
+
+/**
+ * Stream reflection.hpp with all types to disk. Specializations are written one by one, so the whole file is never held in
+ * memory.
+ */
+static void WriteSingleFile(const GeneratorTemplates& templates, const CppContext& context, const GeneratedCode& code,
+                            ArenaAllocator& arena, Opal::DynamicArray<Opal::StringUtf8>& generated_files)
+{
     // Generate includes
-    Opal::StringUtf8 includes;
+    Opal::DynamicArray<Opal::StringUtf8> normalized_paths;
     for (const auto& file_to_include : context.files_to_include)
     {
-        Opal::StringUtf8 normalized_path = Opal::Paths::NormalizePath(file_to_include);
-            if (!includes.IsEmpty())
-            {
-                includes += "\n";
-            }
-            includes += "#include \"" + EscapeCppStringLiteral(normalized_path) + "\"";
+        normalized_paths.PushBack(Opal::Paths::NormalizePath(file_to_include));
     }
-    result = ReplaceAll(result, "__refl_includes__", includes);
+    const Opal::StringUtf8 includes = GenerateIncludes(normalized_paths, arena);
+
+    const Opal::StringUtf8 output_path = Opal::Paths::Combine(context.arguments.output_dir, "reflection.hpp");
+    StreamingFileWriter writer;
+    OpenReflectionFile(writer, output_path);
+    templates.reflection_header.Render(writer,
+                                       [&](Opal::u32 placeholder)
+                                       {
+                                           switch (placeholder)
+                                           {
+                                               case 0:  // __refl_includes__
+                                                   writer.Write(includes);
+                                                   break;
+                                               case 1:  // __refl_definitions__
+                                                   writer.Write(ObsTemplates::k_reflection_definitions_template);
+                                                   break;
+                                               case 2:  // __refl_enum__
+                                                   WriteSpecializations(writer, GetAll(code.enum_specializations));
+                                                   break;
+                                               case 3:  // __refl_class__
+                                                   WriteSpecializations(writer, GetAll(code.class_specializations));
+                                                   break;
+                                               case 4:  // __refl_enum_collection__
+                                                   writer.Write(code.enum_collection);
+                                                   break;
+                                               default:  // __refl_class_collection__
+                                                   writer.Write(code.class_collection);
+                                                   break;
+                                           }
+                                       });
+    CommitReflectionFile(writer, output_path, generated_files);
+}
 
-    // Generate enum specializations
-    Opal::StringUtf8 enum_specs;
-    for (Opal::u64 i = 0; i < context.enums.GetSize(); i++)
+/**
+ * Generated header for a single input header, holding compile-time reflection of the types declared in it.
+ */
+struct SeparateOutputFile
+{
+    // Normalized path of the input header.
+    Opal::StringUtf8 header_path;
+    Opal::StringUtf8 file_name;
+    Opal::DynamicArray<const Opal::StringUtf8*> enum_specializations;
+    Opal::DynamicArray<const Opal::StringUtf8*> class_specializations;
+};
+
+static constexpr const char* k_separate_file_suffix = ".reflection.hpp";
+
+static bool EndsWith(const Opal::StringUtf8& str, const char* suffix)
+{
+    const Opal::u64 suffix_size = strlen(suffix);
+    return str.GetSize() >= suffix_size && memcmp(str.GetData() + str.GetSize() - suffix_size, suffix, suffix_size) == 0;
+}
+
+/**
+ * Group records by the input header that declares them. Every header gets a file named after it, headers with the same
+ * name in different directories get a hash of their path appended so that names stay stable between runs.
+ */
+static Opal::DynamicArray<SeparateOutputFile> GroupRecordsByHeader(const CppContext& context, const GeneratedCode& code)
+{
+    Opal::DynamicArray<SeparateOutputFile> outputs;
+    Opal::HashMap<Opal::StringUtf8, Opal::u64> output_indices;
+    const auto get_output = [&outputs, &output_indices](const Opal::StringUtf8& path) -> SeparateOutputFile&
     {
-        enum_specs += GenerateEnumSpecialization(context.enums[i]);
-        if (i + 1 < context.enums.GetSize())
+        Opal::StringUtf8 normalized_path = Opal::Paths::NormalizePath(path);
+        if (!output_indices.Contains(normalized_path))
         {
-            enum_specs += "\n";
+            output_indices.Insert(normalized_path.Clone(), outputs.GetSize());
+            outputs.PushBack({.header_path = std::move(normalized_path)});
+            return outputs.Back();
         }
+        return outputs[output_indices[normalized_path]];
+    };
+    for (const auto& file_to_include : context.files_to_include)
+    {
+        get_output(file_to_include);
+    }
+    for (Opal::u64 i = 0; i < context.enums.GetSize(); i++)
+    {
+        get_output(context.enums[i].containing_file_path).enum_specializations.PushBack(&code.enum_specializations[i]);
     }
-    result = ReplaceAll(result, "__refl_enum__", enum_specs);
-
-    // Generate class specializations
-    Opal::StringUtf8 class_specs;
     for (Opal::u64 i = 0; i < context.classes.GetSize(); i++)
     {
-        class_specs += GenerateClassSpecialization(context.classes[i]);
-        if (i + 1 < context.classes.GetSize())
+        get_output(context.classes[i].containing_file_path).class_specializations.PushBack(&code.class_specializations[i]);
+    }
+
+    Opal::HashMap<Opal::StringUtf8, Opal::u32> stem_counts;
+    for (auto& output : outputs)
+    {
+        output.file_name = std::move(Opal::Paths::GetStem(output.header_path).GetValue());
+        if (stem_counts.Contains(output.file_name))
+        {
+            stem_counts[output.file_name]++;
+        }
+        else
         {
-            class_specs += "\n";
+            stem_counts.Insert(output.file_name.Clone(), 1);
         }
     }
-    result = ReplaceAll(result, "__refl_class__", class_specs);
+    for (auto& output : outputs)
+    {
+        if (stem_counts[output.file_name] > 1)
+        {
+            const Opal::u64 path_hash = HashXXH64(output.header_path.GetData(), output.header_path.GetSize());
+            output.file_name += Opal::Format("-{:08x}", path_hash & 0xFFFFFFFF);
+        }
+        output.file_name += k_separate_file_suffix;
+    }
+    return outputs;
+}
 
-    // Generate enum collection
-    Opal::StringUtf8 enum_collection = GenerateEnumCollection(context.enums);
-    result = ReplaceAll(result, "__refl_enum_collection__", enum_collection);
+/**
+ * Write one header per input header, a core header with the types shared by all of them and reflection.hpp that includes
+ * all of them and holds the run-time collections. Consumers can include only the headers of the types they use.
+ */
+static void GenerateSeparateFiles(const GeneratorTemplates& templates, const CppContext& context, const GeneratedCode& code,
+                                  ArenaAllocator& arena, Opal::DynamicArray<Opal::StringUtf8>& generated_files)
+{
+    const Opal::DynamicArray<SeparateOutputFile> outputs = GroupRecordsByHeader(context, code);
 
-    // Generate class collection
-    Opal::StringUtf8 class_collection = GenerateClassCollection(context.classes);
-    result = ReplaceAll(result, "__refl_class_collection__", class_collection);
+    const Opal::StringUtf8 core_path = Opal::Paths::Combine(context.arguments.output_dir, "reflection-core.hpp");
+    StreamingFileWriter writer;
+    OpenReflectionFile(writer, core_path);
+    // The only placeholder is __refl_definitions__.
+    templates.reflection_core.Render(writer, [&writer](Opal::u32) { writer.Write(ObsTemplates::k_reflection_definitions_template); });
+    CommitReflectionFile(writer, core_path, generated_files);
 
-    return result;
+    Opal::DynamicArray<Opal::StringUtf8> file_names;
+    for (const auto& output : outputs)
+    {
+        Opal::DynamicArray<Opal::StringUtf8> header_paths;
+        header_paths.PushBack(output.header_path.Clone());
+        const Opal::StringUtf8 includes = GenerateIncludes(header_paths, arena);
+        const Opal::StringUtf8 output_path = Opal::Paths::Combine(context.arguments.output_dir, output.file_name);
+        OpenReflectionFile(writer, output_path);
+        templates.reflection_file.Render(writer,
+                                         [&](Opal::u32 placeholder)
+                                         {
+                                             switch (placeholder)
+                                             {
+                                                 case 0:  // __refl_includes__
+                                                     writer.Write(includes);
+                                                     break;
+                                                 case 1:  // __refl_enum__
+                                                     WriteSpecializations(writer, output.enum_specializations);
+                                                     break;
+                                                 default:  // __refl_class__
+                                                     WriteSpecializations(writer, output.class_specializations);
+                                                     break;
+                                             }
+                                         });
+        CommitReflectionFile(writer, output_path, generated_files);
+        file_names.PushBack(output.file_name.Clone());
+    }
+
+    const Opal::StringUtf8 aggregate_includes = GenerateIncludes(file_names, arena);
+    const Opal::StringUtf8 aggregate_path = Opal::Paths::Combine(context.arguments.output_dir, "reflection.hpp");
+    OpenReflectionFile(writer, aggregate_path);
+    templates.reflection_aggregate.Render(writer,
+                                          [&](Opal::u32 placeholder)
+                                          {
+                                              switch (placeholder)
+                                              {
+                                                  case 0:  // __refl_includes__
+                                                      writer.Write(aggregate_includes);
+                                                      break;
+                                                  case 1:  // __refl_enum_collection__
+                                                      writer.Write(code.enum_collection);
+                                                      break;
+                                                  default:  // __refl_class_collection__
+                                                      writer.Write(code.class_collection);
+                                                      break;
+                                              }
+                                          });
+    CommitReflectionFile(writer, aggregate_path, generated_files);
 }
 
-void Generate(const CppContext& context)
+/**
+ * Remove files that the previous run generated and this run didn't, like headers of input files that were removed or don't
+ * declare reflected types anymore. They would otherwise stay around and could still be included by mistake. Other files in
+ * the output directory are never touched.
+ */
+static void RemoveStaleFiles(const CppContext& context)
+{
+    Opal::HashSet<Opal::StringUtf8> generated_files;
+    for (const auto& path : context.generated_files)
+    {
+        generated_files.Insert(path.Clone());
+    }
+    for (const auto& path : context.previous_generated_files)
+    {
+        if (generated_files.Contains(path))
+        {
+            continue;
+        }
+        // Paths come from the cache file, only remove files with names that the generator produces.
+        const Opal::StringUtf8 file_name = std::move(Opal::Paths::GetFileName(path).GetValue());
+        if (file_name != "reflection.hpp" && file_name != "reflection-core.hpp" && !EndsWith(file_name, k_separate_file_suffix))
+        {
+            continue;
+        }
+        if (Opal::Exists(path))
+        {
+            Opal::GetLogger().Info("Obsidian", "Removing stale reflection file: {}", path.GetData());
+            std::remove(path.GetData());
+        }
+    }
+}
+
+void Generate(CppContext& context)
 {
     if (!Opal::Exists(context.arguments.output_dir))
     {
         Opal::CreateDirectory(context.arguments.output_dir);
     }
 
-    if (!context.arguments.use_separate_files)
+    const GeneratorTemplates templates;
+    // Work items are all types and the two collections, see GenerateCodeParallel. The arenas must outlive the generated code.
+    const Opal::u64 item_count = context.enums.GetSize() + context.classes.GetSize() + 2;
+    GeneratorArenas arenas(Opal::Min<Opal::u64>(Opal::Max<Opal::u32>(context.arguments.job_count, 1), item_count));
+    const GeneratedCode code = GenerateCodeParallel(templates, context, arenas, context.generation_stats);
+    if (context.arguments.use_separate_files)
     {
-        Opal::StringUtf8 content = GenerateSingleFile(context);
-        Opal::StringUtf8 output_path = context.arguments.output_dir + "/reflection.hpp";
-        Opal::GetLogger().Info("Obsidian", "Writing reflection file: {}", output_path.GetData());
-        if (!WriteToFile(output_path, content))
-        {
-            throw FileWriteException(output_path);
-        }
+        GenerateSeparateFiles(templates, context, code, arenas[0], context.generated_files);
+    }
+    else
+    {
+        WriteSingleFile(templates, context, code, arenas[0], context.generated_files);
     }
+    RemoveStaleFiles(context);
+    context.generation_arena_allocations = arenas.GetStats();
 }
@@ -2,4 +2,8 @@
 
 struct CppContext;
 
-void Generate(const CppContext& context);
+/**
+ * Generate the reflection headers for the types in the context. Allocations made while generating code are stored in the
+ * context.
+ */
+void Generate(CppContext& context);
@@ -0,0 +1,179 @@
+#include "hash.hpp"
+
+#include <cstring>
+
+#include "mapped-file.hpp"
+
+static constexpr u64 k_prime1 = 0x9E3779B185EBCA87ull;
+static constexpr u64 k_prime2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr u64 k_prime3 = 0x165667B19E3779F9ull;
+static constexpr u64 k_prime4 = 0x85EBCA77C2B2AE63ull;
+static constexpr u64 k_prime5 = 0x27D4EB2F165667C5ull;
+
+static u64 RotateLeft(u64 value, u32 count)
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+// Reads are done with memcpy since the input is not aligned, compilers turn it into a single load. Assumes a little-endian
+// host, which holds for all platforms Obsidian is built for.
+static u64 Read64(const u8* data)
+{
+    u64 value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static u32 Read32(const u8* data)
+{
+    u32 value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static u64 Round(u64 accumulator, u64 input)
+{
+    accumulator += input * k_prime2;
+    accumulator = RotateLeft(accumulator, 31);
+    return accumulator * k_prime1;
+}
+
+static u64 MergeRound(u64 accumulator, u64 value)
+{
+    accumulator ^= Round(0, value);
+    return accumulator * k_prime1 + k_prime4;
+}
+
+static void ConsumeStripe(u64 (&accumulators)[4], const u8* stripe)
+{
+    accumulators[0] = Round(accumulators[0], Read64(stripe));
+    accumulators[1] = Round(accumulators[1], Read64(stripe + 8));
+    accumulators[2] = Round(accumulators[2], Read64(stripe + 16));
+    accumulators[3] = Round(accumulators[3], Read64(stripe + 24));
+}
+
+static u64 MergeAccumulators(const u64 (&accumulators)[4])
+{
+    u64 hash = RotateLeft(accumulators[0], 1) + RotateLeft(accumulators[1], 7) + RotateLeft(accumulators[2], 12)
+               + RotateLeft(accumulators[3], 18);
+    for (const u64 accumulator : accumulators)
+    {
+        hash = MergeRound(hash, accumulator);
+    }
+    return hash;
+}
+
+/**
+ * Mix in the last bytes that don't fill a whole 32 byte stripe and avalanche the result.
+ */
+static u64 Finalize(u64 hash, const u8* input, const u8* end)
+{
+    while (input + 8 <= end)
+    {
+        hash ^= Round(0, Read64(input));
+        hash = RotateLeft(hash, 27) * k_prime1 + k_prime4;
+        input += 8;
+    }
+    if (input + 4 <= end)
+    {
+        hash ^= static_cast<u64>(Read32(input)) * k_prime1;
+        hash = RotateLeft(hash, 23) * k_prime2 + k_prime3;
+        input += 4;
+    }
+    while (input < end)
+    {
+        hash ^= static_cast<u64>(*input) * k_prime5;
+        hash = RotateLeft(hash, 11) * k_prime1;
+        input++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= k_prime2;
+    hash ^= hash >> 29;
+    hash *= k_prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+u64 HashXXH64(const void* data, u64 size, u64 seed)
+{
+    const u8* input = static_cast<const u8*>(data);
+    const u8* end = input + size;
+    u64 hash;
+
+    if (size >= 32)
+    {
+        u64 accumulators[4] = {seed + k_prime1 + k_prime2, seed + k_prime2, seed, seed - k_prime1};
+        const u8* limit = end - 32;
+        do
+        {
+            ConsumeStripe(accumulators, input);
+            input += 32;
+        } while (input <= limit);
+        hash = MergeAccumulators(accumulators);
+    }
+    else
+    {
+        hash = seed + k_prime5;
+    }
+
+    hash += size;
+    return Finalize(hash, input, end);
+}
+
+HashXXH64Stream::HashXXH64Stream(u64 seed)
+    : m_seed(seed), m_accumulators{seed + k_prime1 + k_prime2, seed + k_prime2, seed, seed - k_prime1}
+{
+}
+
+void HashXXH64Stream::Update(const void* data, u64 size)
+{
+    const u8* input = static_cast<const u8*>(data);
+    m_total_size += size;
+    if (m_buffer_size + size < k_stripe_size)
+    {
+        if (size > 0)
+        {
+            memcpy(m_buffer + m_buffer_size, input, size);
+            m_buffer_size += static_cast<u32>(size);
+        }
+        return;
+    }
+    if (m_buffer_size > 0)
+    {
+        const u64 fill_size = k_stripe_size - m_buffer_size;
+        memcpy(m_buffer + m_buffer_size, input, fill_size);
+        ConsumeStripe(m_accumulators, m_buffer);
+        input += fill_size;
+        size -= fill_size;
+        m_buffer_size = 0;
+    }
+    while (size >= k_stripe_size)
+    {
+        ConsumeStripe(m_accumulators, input);
+        input += k_stripe_size;
+        size -= k_stripe_size;
+    }
+    if (size > 0)
+    {
+        memcpy(m_buffer, input, size);
+        m_buffer_size = static_cast<u32>(size);
+    }
+}
+
+u64 HashXXH64Stream::Digest() const
+{
+    u64 hash = m_total_size >= k_stripe_size ? MergeAccumulators(m_accumulators) : m_seed + k_prime5;
+    hash += m_total_size;
+    return Finalize(hash, m_buffer, m_buffer + m_buffer_size);
+}
+
+u64 HashFileContents(const Opal::StringUtf8& file_path)
+{
+    const MappedFile file(file_path);
+    if (!file.IsValid())
+    {
+        return 0;
+    }
+    return HashXXH64(file.GetData(), file.GetSize());
+}
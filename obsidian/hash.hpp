@@ -0,0 +1,35 @@
+#pragma once
+
+#include "types.hpp"
+
+/**
+ * 64-bit xxHash (XXH64) of the given bytes. Not a cryptographic hash, used to detect changes to file contents.
+ */
+u64 HashXXH64(const void* data, u64 size, u64 seed = 0);
+
+/**
+ * XXH64 of data that is fed in pieces, gives the same result as HashXXH64 on the concatenated pieces.
+ */
+class HashXXH64Stream
+{
+public:
+    explicit HashXXH64Stream(u64 seed = 0);
+
+    void Update(const void* data, u64 size);
+    [[nodiscard]] u64 Digest() const;
+
+private:
+    static constexpr u64 k_stripe_size = 32;
+
+    u64 m_seed = 0;
+    u64 m_accumulators[4] = {};
+    u64 m_total_size = 0;
+    // Bytes that don't fill a whole stripe yet.
+    u8 m_buffer[k_stripe_size] = {};
+    u32 m_buffer_size = 0;
+};
+
+/**
+ * Hash of the whole file contents, read through a memory mapping. Returns 0 if the file can't be read.
+ */
+u64 HashFileContents(const Opal::StringUtf8& file_path);
@@ -0,0 +1,141 @@
+#include "mapped-file.hpp"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const Opal::StringUtf8& file_path)
+{
+#if defined(_WIN32)
+    HANDLE file_handle = CreateFileA(file_path.GetData(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx(file_handle, &file_size) == 0)
+    {
+        CloseHandle(file_handle);
+        return;
+    }
+    m_file_handle = file_handle;
+    m_size = static_cast<u64>(file_size.QuadPart);
+    if (m_size == 0)
+    {
+        // Empty files can't be mapped but they are still valid files.
+        m_is_valid = true;
+        return;
+    }
+    HANDLE mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle == nullptr)
+    {
+        Close();
+        return;
+    }
+    m_mapping_handle = mapping_handle;
+    m_data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        Close();
+        return;
+    }
+    m_is_valid = true;
+#else
+    const int file_descriptor = open(file_path.GetData(), O_RDONLY);
+    if (file_descriptor < 0)
+    {
+        return;
+    }
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0)
+    {
+        close(file_descriptor);
+        return;
+    }
+    m_size = static_cast<u64>(file_stat.st_size);
+    if (m_size == 0)
+    {
+        // Empty files can't be mapped but they are still valid files.
+        close(file_descriptor);
+        m_is_valid = true;
+        return;
+    }
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    // The mapping stays valid after the descriptor is closed.
+    close(file_descriptor);
+    if (data == MAP_FAILED)
+    {
+        m_size = 0;
+        return;
+    }
+    m_data = static_cast<const char*>(data);
+    m_is_valid = true;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_is_valid = other.m_is_valid;
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_is_valid = false;
+#if defined(_WIN32)
+        m_file_handle = other.m_file_handle;
+        m_mapping_handle = other.m_mapping_handle;
+        other.m_file_handle = nullptr;
+        other.m_mapping_handle = nullptr;
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping_handle != nullptr)
+    {
+        CloseHandle(m_mapping_handle);
+    }
+    if (m_file_handle != nullptr)
+    {
+        CloseHandle(m_file_handle);
+    }
+    m_file_handle = nullptr;
+    m_mapping_handle = nullptr;
+#else
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_is_valid = false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "types.hpp"
+
+/**
+ * Read-only view of the whole file mapped into the address space of the process. If the file can't be opened or mapped the
+ * object is left in the invalid state.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const Opal::StringUtf8& file_path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    [[nodiscard]] bool IsValid() const { return m_is_valid; }
+    [[nodiscard]] const char* GetData() const { return m_data; }
+    [[nodiscard]] u64 GetSize() const { return m_size; }
+
+private:
+    void Close();
+
+    const char* m_data = nullptr;
+    u64 m_size = 0;
+    bool m_is_valid = false;
+#if defined(_WIN32)
+    void* m_file_handle = nullptr;
+    void* m_mapping_handle = nullptr;
+#endif
+};
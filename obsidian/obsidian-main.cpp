@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstring>
 
 #include "opal/container/hash-set.h"
@@ -11,9 +14,13 @@
 
 #include "clang-c/Index.h"
 
+#include "allocators.hpp"
 #include "generator.hpp"
 #include "types.hpp"
 #include "cache.hpp"
+#include "prescan.hpp"
+#include "symbol-table.hpp"
+#include "system.hpp"
 
 struct CppTokens
 {
@@ -33,37 +40,6 @@ Opal::StringUtf8 ToString(const CXString& clang_str)
     return str;
 }
 
-CppTokens GetPrevTokens(const CXTranslationUnit& translation_unit, const CXCursor& cursor)
-{
-    CXSourceRange tu_range = clang_getCursorExtent(cursor);
-    CXSourceLocation start = clang_getCursorLocation(cursor);
-    CXFile file;
-    Opal::u32 line, column, offset;
-    clang_getSpellingLocation(start, &file, &line, &column, &offset);
-
-    const auto prev_line = static_cast<Opal::u32>(Opal::Max(0, static_cast<Opal::i32>(line) - 1));
-    CXSourceLocation new_start = clang_getLocation(translation_unit, file, prev_line, 1);
-    CXSourceRange extended_range = clang_getRange(new_start, clang_getRangeEnd(tu_range));
-
-    CXToken* token_data = nullptr;
-    Opal::u32 token_count = 0;
-    clang_tokenize(translation_unit, extended_range, &token_data, &token_count);
-    return {translation_unit, token_data, token_count};
-}
-
-Opal::StringUtf8 GetIncludeFile(const CXTranslationUnit& translation_unit, CXToken& token)
-{
-    CXSourceLocation source_location = clang_getTokenLocation(translation_unit, token);
-
-    CXFile file;
-    u32 line = 0;
-    u32 column = 0;
-    u32 offset = 0;
-    clang_getFileLocation(source_location, &file, &line, &column, &offset);
-
-    return ToString(clang_getFileName(file));
-}
-
 void CollectScope(const CXCursor& cursor, Opal::DynamicArray<Opal::StringUtf8>& parents)
 {
     CXCursor it = cursor;
@@ -80,6 +56,25 @@ void CollectScope(const CXCursor& cursor, Opal::DynamicArray<Opal::StringUtf8>&
     }
 }
 
+/**
+ * Build the fully qualified scope of the cursor, without the trailing '::'. Empty for declarations in the global namespace.
+ */
+Opal::StringUtf8 GetScope(const CXCursor& cursor)
+{
+    Opal::DynamicArray<Opal::StringUtf8> parents;
+    CollectScope(cursor, parents);
+    Opal::StringUtf8 scope;
+    for (Opal::i32 i = static_cast<Opal::i32>(parents.GetSize()) - 1; i >= 0; i--)
+    {
+        scope += parents[i] + "::";
+    }
+    if (!scope.IsEmpty())
+    {
+        scope = std::move(Opal::GetSubString(scope, 0, scope.GetSize() - 2).GetValue());
+    }
+    return scope;
+}
+
 void CollectAttributes(const Opal::ArrayView<CXToken>& tokens, const CXTranslationUnit& translation_unit,
                        Opal::DynamicArray<CppAttribute>& attributes)
 {
@@ -154,18 +149,247 @@ void CollectAttributes(const Opal::ArrayView<CXToken>& tokens, const CXTranslati
     }
 }
 
-Opal::i32 GetMacroTokenPosition(const CppTokens& tokens, const CXTranslationUnit& translation_unit, const Opal::StringUtf8& macro)
+struct TraversalFilter
 {
-    for (Opal::u32 i = 0; i < tokens.count; i++)
+    TraversalMode mode = TraversalMode::Full;
+    // Normalized paths of all input files. Filled in every mode since records are also attributed to input files.
+    Opal::HashSet<Opal::StringUtf8> input_files;
+};
+
+struct MarkerIndex;
+
+struct VisitorContext
+{
+    CppContext* context = nullptr;
+    const TraversalFilter* filter = nullptr;
+    const MarkerIndex* markers = nullptr;
+    SymbolTable* symbols = nullptr;
+    // Normalized path of the input file being parsed, null for unity batches.
+    const Opal::StringUtf8* translation_unit_file = nullptr;
+    // Normalized path of the file given to clang, the generated unity source for unity batches.
+    const Opal::StringUtf8* parsed_file = nullptr;
+
+    // Declarations are visited in source order so consecutive cursors almost always come from the same file. Remember the
+    // last decision to avoid converting and looking up the file name for every cursor.
+    CXFile last_file = nullptr;
+    bool is_last_file_in_scope = false;
+};
+
+bool IsCursorInTraversalScope(const CXCursor& cursor, VisitorContext& visitor_context)
+{
+    const TraversalMode mode = visitor_context.filter->mode;
+    if (mode == TraversalMode::Full)
     {
-        CXString token_spelling = clang_getTokenSpelling(translation_unit, tokens.data[i]);
-        Opal::StringUtf8 token_name = ToString(token_spelling);
-        if (token_name == macro)
+        return true;
+    }
+    CXSourceLocation location = clang_getCursorLocation(cursor);
+    if (clang_Location_isInSystemHeader(location) != 0)
+    {
+        return false;
+    }
+    if (mode == TraversalMode::SkipSystemHeaders)
+    {
+        return true;
+    }
+
+    CXFile file = nullptr;
+    clang_getFileLocation(location, &file, nullptr, nullptr, nullptr);
+    if (file == nullptr)
+    {
+        // Builtin declarations don't belong to any file.
+        return false;
+    }
+    if (file != visitor_context.last_file)
+    {
+        Opal::StringUtf8 file_path = Opal::Paths::NormalizePath(ToString(clang_getFileName(file)));
+        visitor_context.last_file = file;
+        visitor_context.is_last_file_in_scope = visitor_context.filter->input_files.Contains(file_path);
+    }
+    return visitor_context.is_last_file_in_scope;
+}
+
+enum class MarkerKind : u8
+{
+    None,
+    Enum,
+    Class,
+    Property,
+};
+
+/**
+ * Identifies a file independently of the path that was used to include it.
+ */
+struct FileKey
+{
+    u64 data[3] = {0, 0, 0};
+
+    bool operator==(const FileKey& other) const = default;
+    bool operator<(const FileKey& other) const
+    {
+        for (u32 i = 0; i < 3; i++)
         {
-            return i;
+            if (data[i] != other.data[i])
+            {
+                return data[i] < other.data[i];
+            }
         }
+        return false;
     }
-    return -1;
+};
+
+FileKey GetFileKey(CXFile file)
+{
+    FileKey key;
+    CXFileUniqueID unique_id;
+    if (file != nullptr && clang_getFileUniqueID(file, &unique_id) == 0)
+    {
+        for (u32 i = 0; i < 3; i++)
+        {
+            key.data[i] = unique_id.data[i];
+        }
+    }
+    return key;
+}
+
+/**
+ * Expansion of one of the OBS_* macros together with the attributes passed to it.
+ */
+struct ReflectionMarker
+{
+    MarkerKind kind = MarkerKind::None;
+    CXFile file = nullptr;
+    FileKey file_key;
+    u32 line = 0;
+    u32 offset = 0;
+    Opal::DynamicArray<CppAttribute> attributes;
+};
+
+/**
+ * All reflection markers of a translation unit sorted by file and offset. Built once per translation unit from the detailed
+ * preprocessing record so that declarations can be matched with their markers without tokenizing the source again.
+ */
+struct MarkerIndex
+{
+    Opal::DynamicArray<ReflectionMarker> markers;
+};
+
+struct MarkerCollector
+{
+    CXTranslationUnit translation_unit = nullptr;
+    VisitorContext* visitor_context = nullptr;
+    MarkerIndex* index = nullptr;
+};
+
+MarkerKind GetMarkerKind(const char* macro_name)
+{
+    if (strcmp(macro_name, "OBS_ENUM") == 0)
+    {
+        return MarkerKind::Enum;
+    }
+    if (strcmp(macro_name, "OBS_CLASS") == 0)
+    {
+        return MarkerKind::Class;
+    }
+    if (strcmp(macro_name, "OBS_PROP") == 0)
+    {
+        return MarkerKind::Property;
+    }
+    return MarkerKind::None;
+}
+
+CXChildVisitResult MarkerVisitor(CXCursor cursor, CXCursor parent, CXClientData client_data)
+{
+    // Macro expansions are only reported as direct children of the translation unit.
+    if (clang_getCursorKind(cursor) != CXCursor_MacroExpansion)
+    {
+        return CXChildVisit_Continue;
+    }
+
+    CXString spelling = clang_getCursorSpelling(cursor);
+    const MarkerKind kind = GetMarkerKind(clang_getCString(spelling));
+    clang_disposeString(spelling);
+    if (kind == MarkerKind::None)
+    {
+        return CXChildVisit_Continue;
+    }
+
+    auto* collector = static_cast<MarkerCollector*>(client_data);
+    if (!IsCursorInTraversalScope(cursor, *collector->visitor_context))
+    {
+        return CXChildVisit_Continue;
+    }
+
+    ReflectionMarker marker{.kind = kind};
+    clang_getFileLocation(clang_getCursorLocation(cursor), &marker.file, &marker.line, nullptr, &marker.offset);
+    marker.file_key = GetFileKey(marker.file);
+
+    // The extent of the expansion only covers the macro name and its arguments, so this stays cheap.
+    CXToken* token_data = nullptr;
+    Opal::u32 token_count = 0;
+    clang_tokenize(collector->translation_unit, clang_getCursorExtent(cursor), &token_data, &token_count);
+    CppTokens tokens(collector->translation_unit, token_data, token_count);
+    if (tokens.count > 1)
+    {
+        CollectAttributes({tokens.data + 1, tokens.count - 1}, collector->translation_unit, marker.attributes);
+    }
+
+    collector->index->markers.PushBack(std::move(marker));
+    return CXChildVisit_Continue;
+}
+
+bool IsMarkerBefore(const ReflectionMarker& marker, const FileKey& file_key, u32 offset)
+{
+    if (marker.file_key == file_key)
+    {
+        return marker.offset < offset;
+    }
+    return marker.file_key < file_key;
+}
+
+void BuildMarkerIndex(CXTranslationUnit translation_unit, VisitorContext& visitor_context, MarkerIndex& index)
+{
+    MarkerCollector collector{.translation_unit = translation_unit, .visitor_context = &visitor_context, .index = &index};
+    clang_visitChildren(clang_getTranslationUnitCursor(translation_unit), MarkerVisitor, &collector);
+    std::sort(index.markers.GetData(), index.markers.GetData() + index.markers.GetSize(),
+              [](const ReflectionMarker& a, const ReflectionMarker& b) { return IsMarkerBefore(a, b.file_key, b.offset); });
+    Opal::GetLogger().Verbose("Obsidian", "Found {} reflection markers", index.markers.GetSize());
+}
+
+/**
+ * Finds the marker of the given kind that belongs to the declaration. The marker has to precede the declaration and can be at
+ * most one line above the line with the declaration name.
+ */
+const ReflectionMarker* FindMarker(const MarkerIndex& index, const CXCursor& cursor, MarkerKind kind)
+{
+    CXFile file = nullptr;
+    u32 line = 0;
+    u32 start_offset = 0;
+    clang_getFileLocation(clang_getCursorLocation(cursor), &file, &line, nullptr, nullptr);
+    clang_getFileLocation(clang_getRangeStart(clang_getCursorExtent(cursor)), nullptr, nullptr, nullptr, &start_offset);
+    const FileKey file_key = GetFileKey(file);
+
+    const ReflectionMarker* begin = index.markers.GetData();
+    const ReflectionMarker* end = begin + index.markers.GetSize();
+    const ReflectionMarker* it = std::partition_point(
+        begin, end, [&file_key, start_offset](const ReflectionMarker& marker) { return IsMarkerBefore(marker, file_key, start_offset); });
+    while (it != begin)
+    {
+        --it;
+        if (!(it->file_key == file_key) || it->line + 1 < line)
+        {
+            break;
+        }
+        if (it->kind == kind)
+        {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+Opal::StringUtf8 GetIncludeFile(const ReflectionMarker& marker)
+{
+    return ToString(clang_getFileName(marker.file));
 }
 
 Opal::StringUtf8 GetEnumConstantDescription(CXCursor cursor)
@@ -203,44 +427,65 @@ CXChildVisitResult VisitorEnumConstant(CXCursor cursor, CXCursor parent, CXClien
     return CXChildVisit_Continue;
 }
 
-void VisitEnum(CXCursor cursor, CppContext& context)
+/**
+ * Input file a record is attributed to. Types declared in one of the input files belong to that file, since parsing it again
+ * always produces them no matter which translation unit found them first. Other types belong to the translation unit that
+ * found them, which is not known for unity batches.
+ */
+Opal::StringUtf8 GetTranslationUnitPath(const VisitorContext& visitor_context, const Opal::StringUtf8& containing_file_path)
 {
-    CXString name_spelling = clang_getCursorSpelling(cursor);
-    Opal::StringUtf8 name = ToString(name_spelling);
-
-    CXTranslationUnit translation_unit = clang_Cursor_getTranslationUnit(cursor);
-    CppTokens tokens = GetPrevTokens(translation_unit, cursor);
-    Opal::i32 qualifier_pos = GetMacroTokenPosition(tokens, translation_unit, "OBS_ENUM");
-    if (qualifier_pos >= 0)
+    Opal::StringUtf8 normalized_path = Opal::Paths::NormalizePath(containing_file_path);
+    if (visitor_context.filter->input_files.Contains(normalized_path))
+    {
+        return normalized_path;
+    }
+    if (visitor_context.translation_unit_file != nullptr)
     {
-        Opal::StringUtf8 file = GetIncludeFile(translation_unit, tokens.data[qualifier_pos]);
-        CppEnum cpp_enum{.containing_file_path = std::move(file), .name = name.Clone(), .description = ToString(clang_Cursor_getBriefCommentText(cursor))};
-        CXType underlying_type = clang_getEnumDeclIntegerType(cursor);
-        cpp_enum.underlying_type = ToString(clang_getTypeSpelling(underlying_type));
-        cpp_enum.underlying_type_size = clang_Type_getSizeOf(underlying_type);
-        cpp_enum.is_enum_class = clang_EnumDecl_isScoped(cursor) != 0;
-        CollectAttributes({tokens.data + 1, tokens.count - 1}, translation_unit, cpp_enum.attributes);
-        Opal::GetLogger().Verbose("Obsidian", "Detected enum: {} (attributes: {})", name.GetData(), cpp_enum.attributes.GetSize());
-        clang_visitChildren(cursor, VisitorEnumConstant, &cpp_enum);
+        return visitor_context.translation_unit_file->Clone();
+    }
+    return {};
+}
 
-        Opal::DynamicArray<Opal::StringUtf8> parents;
-        CollectScope(cursor, parents);
-        Opal::StringUtf8 scope;
-        for (Opal::i32 i = static_cast<Opal::i32>(parents.GetSize()) - 1; i >= 0; i--)
-        {
-            scope += parents[i] + "::";
-        }
-        if (!scope.IsEmpty())
-        {
-            scope = std::move(Opal::GetSubString(scope, 0, scope.GetSize() - 2).GetValue());
-        }
-        cpp_enum.full_name = scope + "::" + cpp_enum.name;
-        cpp_enum.scope = Opal::Move(scope);
+void VisitEnum(CXCursor cursor, VisitorContext& visitor_context)
+{
+    const ReflectionMarker* marker = FindMarker(*visitor_context.markers, cursor, MarkerKind::Enum);
+    if (marker == nullptr)
+    {
+        return;
+    }
 
-        context.enums.PushBack(std::move(cpp_enum));
+    CXString name_spelling = clang_getCursorSpelling(cursor);
+    Opal::StringUtf8 name = ToString(name_spelling);
+    Opal::StringUtf8 scope = GetScope(cursor);
+    Opal::StringUtf8 full_name = scope + "::" + name;
+    if (visitor_context.symbols->ContainsEnum(full_name))
+    {
+        // Already extracted from another translation unit that includes the same header.
+        return;
     }
+
+    Opal::StringUtf8 file = GetIncludeFile(*marker);
+    CppEnum cpp_enum{.containing_file_path = std::move(file), .name = name.Clone(), .description = ToString(clang_Cursor_getBriefCommentText(cursor))};
+    cpp_enum.full_name = std::move(full_name);
+    cpp_enum.scope = std::move(scope);
+    CXType underlying_type = clang_getEnumDeclIntegerType(cursor);
+    cpp_enum.underlying_type = ToString(clang_getTypeSpelling(underlying_type));
+    cpp_enum.underlying_type_size = clang_Type_getSizeOf(underlying_type);
+    cpp_enum.is_enum_class = clang_EnumDecl_isScoped(cursor) != 0;
+    cpp_enum.attributes = marker->attributes.Clone();
+    Opal::GetLogger().Verbose("Obsidian", "Detected enum: {} (attributes: {})", name.GetData(), cpp_enum.attributes.GetSize());
+    clang_visitChildren(cursor, VisitorEnumConstant, &cpp_enum);
+
+    cpp_enum.translation_unit_path = GetTranslationUnitPath(visitor_context, cpp_enum.containing_file_path);
+    visitor_context.symbols->InsertEnum(std::move(cpp_enum), *visitor_context.parsed_file);
 }
 
+struct PropertyVisitorData
+{
+    CppClass* cpp_class = nullptr;
+    const MarkerIndex* markers = nullptr;
+};
+
 CXChildVisitResult VisitorClassProperty(CXCursor cursor, CXCursor parent, CXClientData client_data)
 {
     CXCursorKind kind = clang_getCursorKind(cursor);
@@ -249,10 +494,9 @@ CXChildVisitResult VisitorClassProperty(CXCursor cursor, CXCursor parent, CXClie
         return CXChildVisit_Continue;
     }
 
-    CXTranslationUnit translation_unit = clang_Cursor_getTranslationUnit(cursor);
-    CppTokens tokens = GetPrevTokens(translation_unit, cursor);
-    Opal::i32 qualifier_pos = GetMacroTokenPosition(tokens, translation_unit, "OBS_PROP");
-    if (qualifier_pos < 0)
+    auto* data = static_cast<PropertyVisitorData*>(client_data);
+    const ReflectionMarker* marker = FindMarker(*data->markers, cursor, MarkerKind::Property);
+    if (marker == nullptr)
     {
         return CXChildVisit_Continue;
     }
@@ -265,18 +509,7 @@ CXChildVisitResult VisitorClassProperty(CXCursor cursor, CXCursor parent, CXClie
     CXCursor type_decl = clang_getTypeDeclaration(type);
     if (!clang_Cursor_isNull(type_decl))
     {
-        Opal::DynamicArray<Opal::StringUtf8> parents;
-        CollectScope(type_decl, parents);
-        Opal::StringUtf8 scope;
-        for (Opal::i32 i = static_cast<Opal::i32>(parents.GetSize()) - 1; i >= 0; i--)
-        {
-            scope += parents[i] + "::";
-        }
-        if (!scope.IsEmpty())
-        {
-            scope = std::move(Opal::GetSubString(scope, 0, scope.GetSize() - 2).GetValue());
-        }
-        property.type_scope = std::move(scope);
+        property.type_scope = GetScope(type_decl);
         property.full_type = property.type_scope.IsEmpty() ? property.type.Clone() : property.type_scope + "::" + property.type;
     }
     else
@@ -289,67 +522,71 @@ CXChildVisitResult VisitorClassProperty(CXCursor cursor, CXCursor parent, CXClie
     property.alignment = clang_Type_getAlignOf(type);
     property.offset = clang_Cursor_getOffsetOfField(cursor) / 8;
     property.size = clang_Type_getSizeOf(type);
-    CollectAttributes({tokens.data + 1, tokens.count - 1}, translation_unit, property.attributes);
+    property.attributes = marker->attributes.Clone();
     Opal::GetLogger().Verbose("Obsidian", "  Detected property: {} (type: {}, attributes: {})", property.name.GetData(),
                               property.type.GetData(), property.attributes.GetSize());
 
-    auto* cpp_class = static_cast<CppClass*>(client_data);
-    cpp_class->properties.PushBack(Opal::Move(property));
+    data->cpp_class->properties.PushBack(Opal::Move(property));
 
     return CXChildVisit_Continue;
 }
 
-void VisitClass(CXCursor cursor, CppContext& context)
+void VisitClass(CXCursor cursor, VisitorContext& visitor_context)
 {
+    const ReflectionMarker* marker = FindMarker(*visitor_context.markers, cursor, MarkerKind::Class);
+    if (marker == nullptr)
+    {
+        return;
+    }
+
     CXString name_spelling = clang_getCursorSpelling(cursor);
     Opal::StringUtf8 name = ToString(name_spelling);
-
-    CXTranslationUnit translation_unit = clang_Cursor_getTranslationUnit(cursor);
-    CppTokens tokens = GetPrevTokens(translation_unit, cursor);
-    Opal::i32 qualifier_pos = GetMacroTokenPosition(tokens, translation_unit, "OBS_CLASS");
-    if (qualifier_pos >= 0)
+    Opal::StringUtf8 scope = GetScope(cursor);
+    Opal::StringUtf8 full_name = scope + "::" + name;
+    if (visitor_context.symbols->ContainsClass(full_name))
     {
-        Opal::StringUtf8 file = GetIncludeFile(translation_unit, tokens.data[qualifier_pos]);
-        CppClass cpp_class{.containing_file_path = std::move(file), .name = name.Clone(), .description = ToString(clang_Cursor_getBriefCommentText(cursor))};
-        cpp_class.is_struct = clang_getCursorKind(cursor) == CXCursor_StructDecl;
-        CXType type = clang_getCursorType(cursor);
-        cpp_class.alignment = clang_Type_getAlignOf(type);
-        cpp_class.size = clang_Type_getSizeOf(type);
-        CollectAttributes({tokens.data + 1, tokens.count - 1}, translation_unit, cpp_class.attributes);
-        Opal::GetLogger().Verbose("Obsidian", "Detected class: {} (attributes: {})", name.GetData(), cpp_class.attributes.GetSize());
+        // Already extracted from another translation unit, skip walking the properties again.
+        return;
+    }
 
-        clang_visitChildren(cursor, VisitorClassProperty, &cpp_class);
+    Opal::StringUtf8 file = GetIncludeFile(*marker);
+    CppClass cpp_class{.containing_file_path = std::move(file), .name = name.Clone(), .description = ToString(clang_Cursor_getBriefCommentText(cursor))};
+    cpp_class.full_name = std::move(full_name);
+    cpp_class.scope = std::move(scope);
+    cpp_class.is_struct = clang_getCursorKind(cursor) == CXCursor_StructDecl;
+    CXType type = clang_getCursorType(cursor);
+    cpp_class.alignment = clang_Type_getAlignOf(type);
+    cpp_class.size = clang_Type_getSizeOf(type);
+    cpp_class.attributes = marker->attributes.Clone();
+    Opal::GetLogger().Verbose("Obsidian", "Detected class: {} (attributes: {})", name.GetData(), cpp_class.attributes.GetSize());
 
-        Opal::DynamicArray<Opal::StringUtf8> parents;
-        CollectScope(cursor, parents);
-        Opal::StringUtf8 scope;
-        for (Opal::i32 i = static_cast<Opal::i32>(parents.GetSize()) - 1; i >= 0; i--)
-        {
-            scope += parents[i] + "::";
-        }
-        if (!scope.IsEmpty())
-        {
-            scope = std::move(Opal::GetSubString(scope, 0, scope.GetSize() - 2).GetValue());
-        }
-        cpp_class.full_name = scope + "::" + cpp_class.name;
-        cpp_class.scope = Opal::Move(scope);
+    PropertyVisitorData property_visitor_data{.cpp_class = &cpp_class, .markers = visitor_context.markers};
+    clang_visitChildren(cursor, VisitorClassProperty, &property_visitor_data);
 
-        context.classes.PushBack(std::move(cpp_class));
-    }
+    cpp_class.translation_unit_path = GetTranslationUnitPath(visitor_context, cpp_class.containing_file_path);
+    visitor_context.symbols->InsertClass(std::move(cpp_class), *visitor_context.parsed_file);
 }
 
 CXChildVisitResult Visitor(CXCursor cursor, CXCursor parent, CXClientData client_data)
 {
-    CXCursorKind kind = clang_getCursorKind(cursor);
-    auto* context = static_cast<CppContext*>(client_data);
+    auto* visitor_context = static_cast<VisitorContext*>(client_data);
+    CppContext& context = *visitor_context->context;
 
+    context.visited_cursor_count++;
+    if (!IsCursorInTraversalScope(cursor, *visitor_context))
+    {
+        context.pruned_cursor_count++;
+        return CXChildVisit_Continue;
+    }
+
+    CXCursorKind kind = clang_getCursorKind(cursor);
     if (kind == CXCursor_EnumDecl)
     {
-        VisitEnum(cursor, *context);
+        VisitEnum(cursor, *visitor_context);
     }
     else if (kind == CXCursor_ClassDecl || kind == CXCursor_StructDecl)
     {
-        VisitClass(cursor, *context);
+        VisitClass(cursor, *visitor_context);
     }
 
     return CXChildVisit_Recurse;
@@ -435,11 +672,40 @@ Opal::DynamicArray<const char*> BuildClangArgs(const ObsidianArguments& program_
     return args_array;
 }
 
-CXTranslationUnit ParseTranslationUnit(const Opal::StringUtf8& input_file, CXIndex index, const Opal::DynamicArray<const char*>& args_array)
+struct ParseOptions
+{
+    u32 extra_flags = 0;
+    // In-memory contents of the input file, used when the input file doesn't exist on disk.
+    CXUnsavedFile* unsaved_file = nullptr;
+    // When false, errors are only logged as verbose messages since the caller is going to handle the failure.
+    bool report_errors = true;
+    // When set, errors are collected here instead of being logged, so that they can be reported together at the end.
+    Opal::DynamicArray<Opal::StringUtf8>* errors = nullptr;
+};
+
+u32 GetParseProfileFlags(ParseProfile profile)
+{
+    switch (profile)
+    {
+        case ParseProfile::Reflection:
+            // Reflection data only depends on declarations, so function bodies can be skipped. Errors are still detected in the
+            // rest of the file, and with KeepGoing they are all reported instead of stopping at the first fatal one.
+            // SingleFileParse is not used since layout of the reflected types depends on the included headers.
+            return CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_KeepGoing | CXTranslationUnit_IgnoreNonErrorsFromIncludedFiles;
+        case ParseProfile::Full:
+        default:
+            return 0;
+    }
+}
+
+CXTranslationUnit ParseTranslationUnit(const Opal::StringUtf8& input_file, CXIndex index, const Opal::DynamicArray<const char*>& args_array,
+                                       const ParseOptions& parse_options = {})
 {
     CXTranslationUnit translation_unit;
-    CXErrorCode error_code = clang_parseTranslationUnit2(index, input_file.GetData(), args_array.GetData(), args_array.GetSize(), nullptr,
-                                                         0, CXTranslationUnit_DetailedPreprocessingRecord, &translation_unit);
+    CXErrorCode error_code = clang_parseTranslationUnit2(
+        index, input_file.GetData(), args_array.GetData(), args_array.GetSize(), parse_options.unsaved_file,
+        parse_options.unsaved_file != nullptr ? 1 : 0, CXTranslationUnit_DetailedPreprocessingRecord | parse_options.extra_flags,
+        &translation_unit);
     if (error_code != CXError_Success)
     {
         Opal::GetLogger().Error("Obsidian",
@@ -460,7 +726,18 @@ CXTranslationUnit ParseTranslationUnit(const Opal::StringUtf8& input_file, CXInd
 
         if (severity >= CXDiagnostic_Error)
         {
-            Opal::GetLogger().Error("Obsidian", "{}", message.GetData());
+            if (!parse_options.report_errors)
+            {
+                Opal::GetLogger().Verbose("Obsidian", "{}", message.GetData());
+            }
+            else if (parse_options.errors != nullptr)
+            {
+                parse_options.errors->PushBack(message.Clone());
+            }
+            else
+            {
+                Opal::GetLogger().Error("Obsidian", "{}", message.GetData());
+            }
             has_errors = true;
         }
         else if (severity == CXDiagnostic_Warning)
@@ -482,39 +759,232 @@ CXTranslationUnit ParseTranslationUnit(const Opal::StringUtf8& input_file, CXInd
     return translation_unit;
 }
 
-void RemoveDuplicates(CppContext& context)
+/**
+ * Parses the prelude header once and serializes it as a precompiled header that all other translation units load instead of
+ * parsing the same includes again. Returns the path to the precompiled header.
+ */
+Opal::StringUtf8 BuildPrecompiledPrelude(CppContext& context, const Opal::DynamicArray<const char*>& clang_args)
+{
+    const auto prelude_start_time = Opal::GetSeconds();
+    const Opal::StringUtf8& prelude_file = context.arguments.prelude_file;
+    // Named after the process so that instances sharing an output directory don't overwrite each other's header.
+    const Opal::StringUtf8 pch_name = Opal::Format("obs-prelude.{}.pch", GetProcessIdentifier());
+    Opal::StringUtf8 pch_path = Opal::Paths::Combine(context.arguments.output_dir, pch_name);
+    Opal::GetLogger().Info("Obsidian", "Precompiling prelude: {}", *prelude_file);
+
+    CXIndex index = clang_createIndex(0, 0);
+    CXTranslationUnit translation_unit = nullptr;
+    try
+    {
+        const u32 extra_flags = GetParseProfileFlags(context.arguments.parse_profile) | CXTranslationUnit_ForSerialization;
+        translation_unit = ParseTranslationUnit(prelude_file, index, clang_args, {.extra_flags = extra_flags});
+    }
+    catch (const Opal::Exception&)
+    {
+        clang_disposeIndex(index);
+        throw;
+    }
+    const int save_result = clang_saveTranslationUnit(translation_unit, pch_path.GetData(), clang_defaultSaveOptions(translation_unit));
+    clang_disposeTranslationUnit(translation_unit);
+    clang_disposeIndex(index);
+    if (save_result != CXSaveError_None)
+    {
+        throw FileWriteException(pch_path);
+    }
+
+    context.prelude_duration = static_cast<f32>(Opal::GetSeconds() - prelude_start_time);
+    Opal::GetLogger().Info("Obsidian", "Precompiled prelude in {:.2f} seconds", context.prelude_duration);
+    return pch_path;
+}
+
+/**
+ * Returns the amount of memory libclang holds for the translation unit, in bytes.
+ */
+u64 GetTranslationUnitMemoryUsage(CXTranslationUnit translation_unit)
 {
-    Opal::HashSet<Opal::StringUtf8> files_to_include;
-    Opal::HashMap<Opal::StringUtf8, CppClass> class_map;
-    for (auto& class_ : context.classes)
+    CXTUResourceUsage usage = clang_getCXTUResourceUsage(translation_unit);
+    u64 total = 0;
+    for (u32 i = 0; i < usage.numEntries; i++)
     {
-        Opal::StringUtf8 normalized_path = Opal::Paths::NormalizePath(class_.containing_file_path);
-        files_to_include.Insert(std::move(normalized_path));
-        class_map.Insert(class_.full_name.Clone(), std::move(class_));
+        total += usage.entries[i].amount;
     }
-    context.classes = class_map.ToArrayOfValues();
-    Opal::HashMap<Opal::StringUtf8, CppEnum> enum_map;
-    for (auto& enum_ : context.enums)
+    clang_disposeCXTUResourceUsage(usage);
+    return total;
+}
+
+struct InclusionCollector
+{
+    CXTranslationUnit translation_unit = nullptr;
+    TranslationUnitIncludes* includes = nullptr;
+};
+
+void InclusionVisitor(CXFile included_file, CXSourceLocation* inclusion_stack, unsigned include_length, CXClientData client_data)
+{
+    // The main file of the translation unit is reported with an empty inclusion stack.
+    if (include_length == 0)
     {
-        Opal::StringUtf8 normalized_path = Opal::Paths::NormalizePath(enum_.containing_file_path);
-        files_to_include.Insert(std::move(normalized_path));
-        enum_map.Insert(enum_.full_name.Clone(), std::move(enum_));
+        return;
     }
-    context.enums = enum_map.ToArrayOfValues();
-    for (auto& path : files_to_include)
+    auto* collector = static_cast<InclusionCollector*>(client_data);
+    CXSourceLocation file_start = clang_getLocationForOffset(collector->translation_unit, included_file, 0);
+    if (clang_Location_isInSystemHeader(file_start) != 0)
     {
-        context.files_to_include.PushBack(std::move(path));
+        return;
     }
+    collector->includes->included_files.PushBack(Opal::Paths::NormalizePath(ToString(clang_getFileName(included_file))));
 }
 
-void ProcessTranslationUnit(CppContext& context, CXIndex index, const Opal::StringUtf8& input_file,
-                            const Opal::DynamicArray<const char*>& clang_args)
+/**
+ * Parses the input file and adds the reflected types found in it to the symbol table.
+ */
+void ProcessTranslationUnit(CppContext& context, SymbolTable& symbols, CXIndex index, const Opal::StringUtf8& input_file,
+                            const Opal::DynamicArray<const char*>& clang_args, const TraversalFilter& filter,
+                            const ParseOptions& parse_options = {})
 {
-    CXTranslationUnit translation_unit = ParseTranslationUnit(input_file, index, clang_args);
+    CXTranslationUnit translation_unit = ParseTranslationUnit(input_file, index, clang_args, parse_options);
     CXCursor cursor = clang_getTranslationUnitCursor(translation_unit);
-    clang_visitChildren(cursor, Visitor, &context);
+    MarkerIndex markers;
+    // Unity batches are parsed from memory and don't correspond to a single input file.
+    const Opal::StringUtf8 normalized_input_file = Opal::Paths::NormalizePath(input_file);
+    VisitorContext visitor_context{
+        .context = &context, .filter = &filter, .markers = &markers, .symbols = &symbols,
+        .translation_unit_file = parse_options.unsaved_file == nullptr ? &normalized_input_file : nullptr,
+        .parsed_file = &normalized_input_file};
+    BuildMarkerIndex(translation_unit, visitor_context, markers);
+    clang_visitChildren(cursor, Visitor, &visitor_context);
+    context.peak_translation_unit_memory = Opal::Max(context.peak_translation_unit_memory, GetTranslationUnitMemoryUsage(translation_unit));
+
+    TranslationUnitIncludes includes;
+    includes.input_files.PushBack(normalized_input_file.Clone());
+    InclusionCollector inclusion_collector{.translation_unit = translation_unit, .includes = &includes};
+    clang_getInclusions(translation_unit, InclusionVisitor, &inclusion_collector);
+    context.includes.PushBack(std::move(includes));
+
     clang_disposeTranslationUnit(translation_unit);
-    RemoveDuplicates(context);
+}
+
+/**
+ * Input file that failed to compile together with the errors reported for it.
+ */
+struct TranslationFailure
+{
+    Opal::StringUtf8 file;
+    Opal::DynamicArray<Opal::StringUtf8> errors;
+};
+
+/**
+ * Shared by all workers. The first failure requests a stop so that workers finish the files they are parsing but don't pick up
+ * new ones. In keep-going mode failures don't stop the compilation, so all broken files are found in one run.
+ */
+class StopToken
+{
+public:
+    explicit StopToken(bool keep_going) : m_keep_going(keep_going) {}
+
+    void RequestStop() { m_is_stop_requested.store(true); }
+    void OnFailure()
+    {
+        if (!m_keep_going)
+        {
+            RequestStop();
+        }
+    }
+    bool IsStopRequested() const { return m_is_stop_requested.load(); }
+    // Called when files are left unparsed because of a stop request.
+    void OnFilesSkipped() { m_were_files_skipped.store(true); }
+    bool WereFilesSkipped() const { return m_were_files_skipped.load(); }
+
+private:
+    std::atomic<bool> m_is_stop_requested = false;
+    std::atomic<bool> m_were_files_skipped = false;
+    bool m_keep_going = false;
+};
+
+/**
+ * Same as ProcessTranslationUnit, but a failure is recorded together with its errors instead of being thrown. Returns false if the
+ * file failed to compile.
+ */
+bool TryProcessTranslationUnit(CppContext& context, SymbolTable& symbols, CXIndex index, const Opal::StringUtf8& input_file,
+                               const Opal::DynamicArray<const char*>& clang_args, const TraversalFilter& filter,
+                               const ParseOptions& parse_options, Opal::DynamicArray<TranslationFailure>& failures, StopToken& stop_token)
+{
+    Opal::DynamicArray<Opal::StringUtf8> errors;
+    ParseOptions file_parse_options = parse_options;
+    file_parse_options.errors = &errors;
+    try
+    {
+        ProcessTranslationUnit(context, symbols, index, input_file, clang_args, filter, file_parse_options);
+        return true;
+    }
+    catch (const TranslationFailedException& exception)
+    {
+        if (errors.IsEmpty())
+        {
+            errors.PushBack(*exception.What());
+        }
+        failures.PushBack({.file = input_file.Clone(), .errors = std::move(errors)});
+        stop_token.OnFailure();
+        return false;
+    }
+    catch (const Opal::Exception& exception)
+    {
+        // Anything other than a compilation error means that something is wrong with the setup, so stop even in keep-going
+        // mode.
+        errors.PushBack(*exception.What());
+        failures.PushBack({.file = input_file.Clone(), .errors = std::move(errors)});
+        stop_token.RequestStop();
+        return false;
+    }
+}
+
+/**
+ * Parses a batch of input files as a single translation unit that includes all of them, so that includes shared between them
+ * are only parsed once. If the batch fails to compile, the files are parsed one by one to find out which of them are at fault.
+ */
+void ProcessUnityBatch(CppContext& context, SymbolTable& symbols, CXIndex index, const Opal::DynamicArray<Opal::StringUtf8>& batch, u64 batch_index,
+                       const Opal::DynamicArray<const char*>& clang_args, const TraversalFilter& filter, const ParseOptions& parse_options,
+                       Opal::DynamicArray<TranslationFailure>& failures, StopToken& stop_token)
+{
+    // The unity file is placed in the working directory, same as relative input paths, so that quoted includes resolve.
+    Opal::StringUtf8 unity_file = Opal::Format("obs-unity-{}.hpp", batch_index);
+    Opal::StringUtf8 unity_content;
+    for (const auto& path : batch)
+    {
+        unity_content += "#include \"" + Opal::Paths::NormalizePath(path) + "\"\n";
+    }
+    CXUnsavedFile unsaved_file{.Filename = *unity_file, .Contents = *unity_content, .Length = static_cast<unsigned long>(unity_content.GetSize())};
+
+    try
+    {
+        ParseOptions unity_parse_options = parse_options;
+        unity_parse_options.unsaved_file = &unsaved_file;
+        unity_parse_options.report_errors = false;
+        unity_parse_options.errors = nullptr;
+        ProcessTranslationUnit(context, symbols, index, unity_file, clang_args, filter, unity_parse_options);
+        // Every file of the batch depends on everything the batch includes.
+        TranslationUnitIncludes& includes = context.includes.Back();
+        includes.input_files.Clear();
+        for (const auto& path : batch)
+        {
+            includes.input_files.PushBack(Opal::Paths::NormalizePath(path));
+        }
+        return;
+    }
+    catch (const TranslationFailedException&)
+    {
+        Opal::GetLogger().Warning("Obsidian", "Unity batch {} failed to compile, compiling its {} files one by one", batch_index,
+                                  batch.GetSize());
+    }
+    for (const auto& path : batch)
+    {
+        if (stop_token.IsStopRequested())
+        {
+            stop_token.OnFilesSkipped();
+            break;
+        }
+        Opal::GetLogger().Info("Obsidian", "Compiling file: {}", *path);
+        TryProcessTranslationUnit(context, symbols, index, path, clang_args, filter, parse_options, failures, stop_token);
+    }
 }
 
 bool IsValidExtension(const Opal::StringUtf8& extension)
@@ -525,64 +995,364 @@ bool IsValidExtension(const Opal::StringUtf8& extension)
 struct TaskData
 {
     CppContext result;
+    Opal::DynamicArray<TranslationFailure> failures;
     Opal::SharedPtr<Opal::Task> task_handle;
 };
 
-void ProcessTranslationUnitParallel(CppContext& context, const Opal::DynamicArray<const char*>& clang_args)
+/**
+ * Group of input files parsed by a single task. A batch holds a single file unless unity build is used.
+ */
+struct CompilationBatch
+{
+    Opal::DynamicArray<Opal::StringUtf8> files;
+    f64 estimated_duration = 0.0;
+    f64 duration = 0.0;
+};
+
+struct FileCost
+{
+    u64 file_index = 0;
+    f64 duration = 0.0;
+    bool is_known = false;
+};
+
+/**
+ * Split the files into batches ordered from the most to the least expensive one, based on parse durations from the previous
+ * run. Files that were never parsed before are placed first since their cost is unknown. In unity mode files are distributed
+ * over one batch per worker so that all batches take roughly the same time.
+ */
+Opal::DynamicArray<CompilationBatch> ScheduleBatches(CppContext& context, const Opal::DynamicArray<Opal::StringUtf8>& files_to_parse,
+                                                     u64 worker_count)
 {
-    auto cpu_info = Opal::GetCpuInfo();
-    i32 physical_core_count = static_cast<i32>(cpu_info.physical_processors.GetSize());
-    Opal::GetLogger().Info("Obsidian", "Thread pool created with {} threads", physical_core_count);
-    Opal::ThreadPool thread_pool(physical_core_count, 128);
-    Opal::ChannelMPMC<CXIndex> clang_indices(physical_core_count);
-    for (i32 i = 0; i < physical_core_count; i++)
+    Opal::DynamicArray<FileCost> costs;
+    costs.Reserve(files_to_parse.GetSize());
+    f64 max_known_duration = 0.0;
+    for (u64 i = 0; i < files_to_parse.GetSize(); i++)
     {
-        CXIndex index = clang_createIndex(0, 0);
-        clang_indices.transmitter.Send(index);
+        FileCost cost{.file_index = i};
+        const Opal::StringUtf8 path = Opal::Paths::NormalizePath(files_to_parse[i]);
+        if (context.estimated_parse_durations.Contains(path))
+        {
+            cost.duration = context.estimated_parse_durations[path];
+            cost.is_known = true;
+            max_known_duration = Opal::Max(max_known_duration, cost.duration);
+        }
+        costs.PushBack(cost);
     }
-    Opal::DynamicArray<TaskData> tasks;
-    tasks.Reserve(context.input_files.GetSize());
+    // Assume unknown files are as expensive as the most expensive known one, or treat all files equally on the first run.
+    const f64 unknown_duration = max_known_duration > 0.0 ? max_known_duration : 1.0;
+    for (auto& cost : costs)
+    {
+        if (!cost.is_known)
+        {
+            cost.duration = unknown_duration;
+        }
+    }
+    std::stable_sort(costs.GetData(), costs.GetData() + costs.GetSize(),
+                     [](const FileCost& a, const FileCost& b)
+                     {
+                         if (a.is_known != b.is_known)
+                         {
+                             return !a.is_known;
+                         }
+                         return a.duration > b.duration;
+                     });
+
+    Opal::DynamicArray<CompilationBatch> batches;
+    if (!context.arguments.use_unity_build)
+    {
+        batches.Reserve(costs.GetSize());
+        for (const auto& cost : costs)
+        {
+            batches.PushBack({});
+            batches.Back().files.PushBack(files_to_parse[cost.file_index].Clone());
+            batches.Back().estimated_duration = cost.duration;
+        }
+        return batches;
+    }
+
+    // Longest processing time first: every file goes to the batch with the smallest estimated duration so far.
+    const u64 batch_count = Opal::Min<u64>(worker_count, files_to_parse.GetSize());
+    for (u64 i = 0; i < batch_count; i++)
+    {
+        batches.PushBack({});
+    }
+    for (const auto& cost : costs)
+    {
+        CompilationBatch* cheapest = &batches[0];
+        for (auto& batch : batches)
+        {
+            if (batch.estimated_duration < cheapest->estimated_duration)
+            {
+                cheapest = &batch;
+            }
+        }
+        cheapest->files.PushBack(files_to_parse[cost.file_index].Clone());
+        cheapest->estimated_duration += cost.duration;
+    }
+    std::stable_sort(batches.GetData(), batches.GetData() + batches.GetSize(),
+                     [](const CompilationBatch& a, const CompilationBatch& b) { return a.estimated_duration > b.estimated_duration; });
+    return batches;
+}
+
+/**
+ * Log errors of all files that failed to compile, grouped by file.
+ */
+void ReportFailures(Opal::DynamicArray<TranslationFailure>& failures, u64 file_count, bool was_stopped_early)
+{
+    std::sort(failures.GetData(), failures.GetData() + failures.GetSize(),
+              [](const TranslationFailure& a, const TranslationFailure& b) { return strcmp(a.file.GetData(), b.file.GetData()) < 0; });
+    for (const auto& failure : failures)
+    {
+        Opal::GetLogger().Error("Obsidian", "Failed to compile C++ file: {}", *failure.file);
+        for (const auto& error : failure.errors)
+        {
+            Opal::GetLogger().Error("Obsidian", "  {}", *error);
+        }
+    }
+    if (was_stopped_early)
+    {
+        Opal::GetLogger().Error("Obsidian", "Compilation stopped after the first failure, use keep-going=true to find all failing files");
+    }
+    else
+    {
+        Opal::GetLogger().Error("Obsidian", "{} out of {} files failed to compile", failures.GetSize(), file_count);
+    }
+}
+
+void ProcessTranslationUnitParallel(CppContext& context, SymbolTable& symbols, const Opal::DynamicArray<Opal::StringUtf8>& files_to_parse,
+                                    const Opal::DynamicArray<const char*>& clang_args)
+{
+    const auto compilation_start_time = Opal::GetSeconds();
+    const u32 job_count = context.arguments.job_count;
+    Opal::GetLogger().Info("Obsidian", "Thread pool created with {} threads", job_count);
+    Opal::ThreadPool thread_pool(static_cast<i32>(job_count), 128);
+    TraversalFilter filter{.mode = context.arguments.traversal_mode};
     for (const auto& path : context.input_files)
+    {
+        filter.input_files.Insert(Opal::Paths::NormalizePath(path));
+    }
+    const ParseOptions parse_options{.extra_flags = GetParseProfileFlags(context.arguments.parse_profile)};
+
+    Opal::DynamicArray<CompilationBatch> batches = ScheduleBatches(context, files_to_parse, job_count);
+    u64 worker_count = Opal::Min<u64>(job_count, batches.GetSize());
+    const u64 memory_budget = context.arguments.memory_budget_bytes;
+    if (memory_budget > 0 && context.estimated_translation_unit_memory > 0)
+    {
+        const u64 max_concurrent_units = Opal::Max<u64>(1, memory_budget / context.estimated_translation_unit_memory);
+        if (max_concurrent_units < worker_count)
+        {
+            Opal::GetLogger().Info("Obsidian", "Limiting to {} concurrent translation units to stay within the memory budget",
+                                   max_concurrent_units);
+            worker_count = max_concurrent_units;
+        }
+    }
+    context.compilation_stats.worker_count = static_cast<u32>(worker_count);
+    // Largest translation unit seen so far, shared between workers so that they can back off once it turns out that the
+    // translation units need more memory than the estimate.
+    std::atomic<u64> peak_translation_unit_memory = context.estimated_translation_unit_memory;
+
+    // Instead of submitting a task per batch, every worker pulls the next batch as soon as it is done with the previous one.
+    // Batches are ordered from the most expensive one, so the cheap ones at the end fill the gaps and no worker is left
+    // with a large file while others are idle.
+    std::atomic<u64> next_batch_index = 0;
+    StopToken stop_token(context.arguments.keep_going);
+    Opal::DynamicArray<TaskData> tasks;
+    tasks.Reserve(worker_count);
+    for (u64 worker_index = 0; worker_index < worker_count; worker_index++)
     {
         tasks.PushBack({});
         TaskData& task = tasks.Back();
         task.task_handle = thread_pool.AddFunctionTask(
-            [file_path = path.Clone(), &task, &clang_args, &clang_indices](Opal::Task::TransmitterType& transmitter)
+            [&batches, &next_batch_index, &peak_translation_unit_memory, worker_index, memory_budget,
+             use_unity_build = context.arguments.use_unity_build, &task, &clang_args, &filter, &parse_options,
+             &symbols, &stop_token](Opal::Task::TransmitterType& transmitter)
             {
+                CXIndex index = clang_createIndex(0, 0);
+                u64 batch_index = 0;
                 try
                 {
-                    auto status = clang_indices.receiver.Receive();
-                    if (status.HasValue())
+                    while (!stop_token.IsStopRequested())
                     {
-                        const CXIndex index = status.GetValue();
-                        Opal::GetLogger().Info("Obsidian", "Compiling file: {}", *file_path);
-                        ProcessTranslationUnit(task.result, index, file_path, clang_args);
-                        clang_indices.transmitter.Send(index);
+                        // The first worker always keeps going so that all batches get processed.
+                        const u64 peak_memory = peak_translation_unit_memory.load();
+                        if (memory_budget > 0 && peak_memory > 0 && worker_index > 0 && worker_index >= memory_budget / peak_memory)
+                        {
+                            Opal::GetLogger().Verbose("Obsidian", "Worker {} stopped to stay within the memory budget", worker_index);
+                            break;
+                        }
+                        batch_index = next_batch_index.fetch_add(1);
+                        if (batch_index >= batches.GetSize())
+                        {
+                            break;
+                        }
+                        CompilationBatch& batch = batches[batch_index];
+                        const auto batch_start_time = Opal::GetSeconds();
+                        if (use_unity_build)
+                        {
+                            Opal::GetLogger().Info("Obsidian", "Compiling unity batch {} with {} files", batch_index, batch.files.GetSize());
+                            ProcessUnityBatch(task.result, symbols, index, batch.files, batch_index, clang_args, filter, parse_options,
+                                              task.failures, stop_token);
+                        }
+                        else
+                        {
+                            Opal::GetLogger().Info("Obsidian", "Compiling file: {}", *batch.files[0]);
+                            TryProcessTranslationUnit(task.result, symbols, index, batch.files[0], clang_args, filter, parse_options,
+                                                      task.failures, stop_token);
+                        }
+                        batch.duration = Opal::GetSeconds() - batch_start_time;
+                        u64 expected = peak_translation_unit_memory.load();
+                        while (task.result.peak_translation_unit_memory > expected &&
+                               !peak_translation_unit_memory.compare_exchange_weak(expected, task.result.peak_translation_unit_memory))
+                        {
+                        }
                     }
                 }
                 catch (const Opal::Exception& exception)
                 {
-                    Opal::GetLogger().Error("Obsidian", *exception.What());
-                    exit(1);
+                    // Anything other than a compilation error means that something is wrong with the setup, so stop even
+                    // in keep-going mode. Errors of single files are reported by TryProcessTranslationUnit, so this is a
+                    // failure of a whole unity batch.
+                    TranslationFailure failure{
+                        .file = batch_index < batches.GetSize() ? Opal::Format("unity batch {}", batch_index) : "unknown"};
+                    failure.errors.PushBack(*exception.What());
+                    task.failures.PushBack(std::move(failure));
+                    stop_token.RequestStop();
                 }
+                clang_disposeIndex(index);
             });
     }
+    Opal::DynamicArray<TranslationFailure> failures;
     for (auto& task : tasks)
     {
         task.task_handle->WaitForCompletion();
-        context.classes.Append(std::move(task.result.classes));
-        context.enums.Append(std::move(task.result.enums));
+        for (auto& failure : task.failures)
+        {
+            failures.PushBack(std::move(failure));
+        }
+        context.visited_cursor_count += task.result.visited_cursor_count;
+        context.pruned_cursor_count += task.result.pruned_cursor_count;
+        context.peak_translation_unit_memory = Opal::Max(context.peak_translation_unit_memory, task.result.peak_translation_unit_memory);
+        for (auto& includes : task.result.includes)
+        {
+            context.includes.PushBack(std::move(includes));
+        }
     }
-    RemoveDuplicates(context);
-    while (true)
+    // Workers only leave batches unclaimed when a stop was requested.
+    if (next_batch_index.load() < batches.GetSize())
     {
-        CXIndex index;
-        if (clang_indices.receiver.TryReceive(index) != Opal::ErrorCode::Success)
+        stop_token.OnFilesSkipped();
+    }
+    if (!failures.IsEmpty())
+    {
+        ReportFailures(failures, files_to_parse.GetSize(), stop_token.WereFilesSkipped());
+        throw CompilationFailedException(failures.GetSize());
+    }
+
+    ParallelPhaseStats& stats = context.compilation_stats;
+    for (u64 batch_index = 0; batch_index < batches.GetSize(); batch_index++)
+    {
+        const CompilationBatch& batch = batches[batch_index];
+        stats.AddItem(batch.duration,
+                      context.arguments.use_unity_build ? Opal::Format("unity batch {}", batch_index) : batch.files[0].Clone());
+        // Files of a unity batch are parsed together, so split the cost of the batch evenly between them.
+        const f64 file_duration = batch.duration / static_cast<f64>(batch.files.GetSize());
+        for (const auto& path : batch.files)
         {
-            break;
+            context.measured_parse_durations.Insert(Opal::Paths::NormalizePath(path), file_duration);
+        }
+    }
+    stats.duration = static_cast<f32>(Opal::GetSeconds() - compilation_start_time);
+    const f32 average_work = stats.work_duration / static_cast<f32>(Opal::Max<u64>(1, worker_count));
+    const f32 critical_path = Opal::Max(stats.longest_item_duration, average_work);
+    Opal::GetLogger().Info("Obsidian", "Compilation took {:.2f} seconds, lower bound with {} workers is {:.2f} seconds", stats.duration,
+                           worker_count, critical_path);
+}
+
+Opal::DynamicArray<Opal::StringUtf8> PrescanInputFiles(CppContext& context, const Opal::DynamicArray<Opal::StringUtf8>& files)
+{
+    const auto prescan_start_time = Opal::GetSeconds();
+    Opal::DynamicArray<Opal::StringUtf8> annotated_files;
+    for (const auto& path : files)
+    {
+        if (HasReflectionMarkers(path))
+        {
+            annotated_files.PushBack(path.Clone());
+        }
+        else
+        {
+            Opal::GetLogger().Verbose("Obsidian", "Skipping file without reflection markers: {}", *path);
         }
-        clang_disposeIndex(index);
     }
+    context.prescan_skipped_file_count = files.GetSize() - annotated_files.GetSize();
+    context.prescan_duration = static_cast<f32>(Opal::GetSeconds() - prescan_start_time);
+    Opal::GetLogger().Info("Obsidian", "Pre-scan skipped {} out of {} files in {:.3f} seconds", context.prescan_skipped_file_count,
+                           files.GetSize(), context.prescan_duration);
+    return annotated_files;
+}
+
+/**
+ * Escape a path for use in a Makefile rule, which is also the format Ninja expects.
+ */
+Opal::StringUtf8 EscapeMakePath(const Opal::StringUtf8& path)
+{
+    Opal::StringUtf8 escaped;
+    escaped.Reserve(path.GetSize());
+    for (u64 i = 0; i < path.GetSize(); i++)
+    {
+        const char c = path.GetData()[i];
+        if (c == ' ' || c == '#')
+        {
+            escaped.Append('\\');
+        }
+        else if (c == '$')
+        {
+            escaped.Append('$');
+        }
+        escaped.Append(c);
+    }
+    return escaped;
+}
+
+/**
+ * Write a Make style depfile listing the generated file as depending on all input files and every header they include, so
+ * that the build system only runs Obsidian again when one of them changes.
+ */
+void WriteDepfile(const ObsidianArguments& arguments, const Cache& cache)
+{
+    const Opal::StringUtf8 output_file = Opal::Paths::Combine(arguments.output_dir, "reflection.hpp");
+    Opal::StringUtf8 content = EscapeMakePath(Opal::Paths::NormalizePath(output_file)) + ":";
+    if (!arguments.prelude_file.IsEmpty())
+    {
+        content += " \\\n  " + EscapeMakePath(Opal::Paths::NormalizePath(arguments.prelude_file));
+    }
+    for (const auto& file : cache.files)
+    {
+        content += " \\\n  " + EscapeMakePath(file.path);
+    }
+    for (const auto& dependency : cache.dependency_files)
+    {
+        content += " \\\n  " + EscapeMakePath(dependency.path);
+    }
+    content += "\n";
+    Opal::WriteStringToFile(arguments.depfile, content);
+    Opal::GetLogger().Info("Obsidian", "Writing depfile: {}", *arguments.depfile);
+}
+
+/**
+ * Check that every file written by the run that produced the cache is still on disk, a deleted output must be generated again
+ * even when none of the inputs changed.
+ */
+bool AreGeneratedFilesPresent(const CacheView& cache)
+{
+    for (u32 i = 0; i < cache.GetGeneratedFileCount(); i++)
+    {
+        if (!Opal::Exists(cache.GetGeneratedFile(i).ToString()))
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 void Run(CppContext& context)
@@ -629,31 +1399,138 @@ void Run(CppContext& context)
         }
     }
 
+    // Instances sharing the cache file run one after another, the later ones then find everything cached instead of racing
+    // to write the cache and the generated files.
+    FileLock cache_lock;
+    if (!cache_lock.Acquire(context.arguments.cache_file + ".lock"))
+    {
+        Opal::GetLogger().Warning("Obsidian", "Failed to lock cache file {}, continuing without the lock", *context.arguments.cache_file);
+    }
+
     auto cache_start_time = Opal::GetSeconds();
-    auto cache_status = LoadCacheFromDisk();
-    if (cache_status.HasValue())
+    // The previous cache is mapped, records are only decoded for input files that don't need to be parsed again.
+    CacheView cache;
+    const bool is_cache_loaded = LoadCacheFromDisk(context.arguments.cache_file, cache);
+    Cache new_cache;
+    IncrementalPlan plan;
+    try
     {
-        const Opal::StringUtf8 output_file = Opal::Paths::Combine(context.arguments.output_dir, "reflection.hpp");
-        Cache cache = std::move(cache_status.GetValue());
-        Cache new_cache = CreateCache(context.arguments, context.input_files);
-        if (Opal::Exists(output_file) && CompareCaches(cache, new_cache))
+        new_cache = CreateCache(context.arguments, context.input_files, is_cache_loaded ? &cache : nullptr, &context.hashing_stats);
+        if (is_cache_loaded)
         {
-            Opal::GetLogger().Info("Obsidian", "Everything cached, no need to generate it again...");
-            context.cache_duration = static_cast<f32>(Opal::GetSeconds() - cache_start_time);
-            return;
+            const CacheDiff diff = CompareCaches(cache, new_cache);
+            if (diff.IsEmpty() && AreGeneratedFilesPresent(cache))
+            {
+                Opal::GetLogger().Info("Obsidian", "Everything cached, no need to generate it again...");
+                cache.Close();
+                context.cache_duration = static_cast<f32>(Opal::GetSeconds() - cache_start_time);
+                if (!context.arguments.depfile.IsEmpty())
+                {
+                    WriteDepfile(context.arguments, new_cache);
+                }
+                if (!context.arguments.dump_cache.IsEmpty())
+                {
+                    ExportCacheFileToJson(context.arguments.cache_file, context.arguments.dump_cache);
+                }
+                return;
+            }
+            context.estimated_translation_unit_memory = cache.GetPeakTranslationUnitMemory();
+            for (u32 i = 0; i < cache.GetFileCount(); i++)
+            {
+                const CachedFile file = cache.GetFile(i);
+                if (file.parse_duration > 0.0)
+                {
+                    context.estimated_parse_durations.Insert(file.path.ToString(), file.parse_duration);
+                }
+            }
+            plan = PlanIncrementalBuild(cache, new_cache, diff);
+            for (u32 i = 0; i < cache.GetGeneratedFileCount(); i++)
+            {
+                context.previous_generated_files.PushBack(cache.GetGeneratedFile(i).ToString());
+            }
+            // Everything needed from the previous cache is copied out, the file is written again at the end.
+            cache.Close();
         }
-        SaveCacheToDisk(new_cache);
     }
-    else
+    catch (const CacheCorruptException&)
     {
-        Cache new_cache = CreateCache(context.arguments, context.input_files);
-        SaveCacheToDisk(new_cache);
+        // The view only checks what it reads, so this can happen half way through. Everything taken from the cache so far is
+        // dropped and all input files are parsed again.
+        Opal::GetLogger().Warning("Obsidian", "Ignoring cache file {} since it's corrupt", *context.arguments.cache_file);
+        cache.Close();
+        context.estimated_translation_unit_memory = 0;
+        context.estimated_parse_durations = Opal::HashMap<Opal::StringUtf8, f64>();
+        context.previous_generated_files.Clear();
+        new_cache = CreateCache(context.arguments, context.input_files, nullptr, &context.hashing_stats);
+        plan = IncrementalPlan();
     }
     context.cache_duration = static_cast<f32>(Opal::GetSeconds() - cache_start_time);
 
+    Opal::DynamicArray<Opal::StringUtf8> changed_files;
+    if (plan.is_full_rebuild)
+    {
+        changed_files = context.input_files.Clone();
+    }
+    else
+    {
+        Opal::GetLogger().Info("Obsidian", "Parsing {} out of {} files, reusing cached data for the rest", plan.files_to_parse.GetSize(),
+                               context.input_files.GetSize());
+        changed_files = std::move(plan.files_to_parse);
+    }
+    Opal::DynamicArray<Opal::StringUtf8> files_to_parse;
+    if (context.arguments.should_prescan)
+    {
+        files_to_parse = PrescanInputFiles(context, changed_files);
+    }
+    else
+    {
+        files_to_parse = std::move(changed_files);
+    }
+
+    // The precompiled prelude is only needed during compilation, it's removed even if compilation fails.
+    struct PreludePchRemover
+    {
+        Opal::StringUtf8 path;
+        ~PreludePchRemover()
+        {
+            if (!path.IsEmpty())
+            {
+                std::remove(*path);
+            }
+        }
+    } prelude_pch;
+    if (!context.arguments.prelude_file.IsEmpty())
+    {
+        prelude_pch.path = BuildPrecompiledPrelude(context, clang_args);
+        clang_args.PushBack("-include-pch");
+        clang_args.PushBack(*prelude_pch.path);
+    }
+
+    // Workers insert the types they find directly into the shared table, so duplicates coming from headers included by
+    // several input files are dropped as soon as they are seen.
+    SymbolTable symbols;
     const auto compilation_start_time = Opal::GetSeconds();
-    ProcessTranslationUnitParallel(context, clang_args);
+    const AllocationStats compilation_start_allocations = context.allocation_counter->GetStats();
+    ProcessTranslationUnitParallel(context, symbols, files_to_parse, clang_args);
+    // Cached records are added last so that records from files that were just parsed take precedence.
+    for (auto& cpp_enum : plan.cached_enums)
+    {
+        const Opal::StringUtf8 defining_file = cpp_enum.translation_unit_path.Clone();
+        symbols.InsertEnum(std::move(cpp_enum), defining_file);
+    }
+    for (auto& cpp_class : plan.cached_classes)
+    {
+        const Opal::StringUtf8 defining_file = cpp_class.translation_unit_path.Clone();
+        symbols.InsertClass(std::move(cpp_class), defining_file);
+    }
+    symbols.MoveTo(context);
     context.compilation_duration = static_cast<f32>(Opal::GetSeconds() - compilation_start_time);
+    context.compilation_allocations = context.allocation_counter->GetStats() - compilation_start_allocations;
+    if (!prelude_pch.path.IsEmpty())
+    {
+        std::remove(*prelude_pch.path);
+        prelude_pch.path.Clear();
+    }
 
     Opal::GetLogger().Verbose("Obsidian", "Found {} enums and {} classes", context.enums.GetSize(), context.classes.GetSize());
 
@@ -664,8 +1541,43 @@ void Run(CppContext& context)
 
     Opal::GetLogger().Info("Obsidian", "Generating reflection data...");
     auto generation_start_time = Opal::GetSeconds();
+    const AllocationStats generation_start_allocations = context.allocation_counter->GetStats();
     Generate(context);
     context.generation_duration = static_cast<f32>(Opal::GetSeconds() - generation_start_time);
+    context.generation_allocations = context.allocation_counter->GetStats() - generation_start_allocations;
+
+    // The cache is only saved once the reflection data is generated, together with the extracted records and parse durations
+    // for the next run. Files that were not parsed this time keep their previous durations.
+    cache_start_time = Opal::GetSeconds();
+    for (auto& file : new_cache.files)
+    {
+        if (context.measured_parse_durations.Contains(file.path))
+        {
+            file.parse_duration = context.measured_parse_durations[file.path];
+        }
+        else if (context.estimated_parse_durations.Contains(file.path))
+        {
+            file.parse_duration = context.estimated_parse_durations[file.path];
+        }
+    }
+    new_cache.peak_translation_unit_memory = context.peak_translation_unit_memory > 0 ? context.peak_translation_unit_memory
+                                                                                       : context.estimated_translation_unit_memory;
+    new_cache.has_records = true;
+    new_cache.enums = context.enums.Clone();
+    new_cache.classes = context.classes.Clone();
+    new_cache.generated_files = context.generated_files.Clone();
+    UpdateDependencies(new_cache, context.includes, context.arguments.job_count);
+    SaveCacheToDisk(new_cache, context.arguments.cache_file);
+    context.cache_duration += static_cast<f32>(Opal::GetSeconds() - cache_start_time);
+
+    if (!context.arguments.depfile.IsEmpty())
+    {
+        WriteDepfile(context.arguments, new_cache);
+    }
+    if (!context.arguments.dump_cache.IsEmpty())
+    {
+        ExportCacheFileToJson(context.arguments.cache_file, context.arguments.dump_cache);
+    }
 }
 
 bool IsValidStandard(const Opal::StringUtf8& std, const Opal::ArrayView<const Opal::StringUtf8> standards)
@@ -680,6 +1592,38 @@ bool IsValidStandard(const Opal::StringUtf8& std, const Opal::ArrayView<const Op
     return false;
 }
 
+// Upper limits of numeric arguments. Larger values are almost certainly typos and would overflow when converted.
+static constexpr u64 k_max_job_count = 1024;
+static constexpr u64 k_max_memory_budget_mb = 1024ull * 1024 * 1024;
+
+/**
+ * Parse a decimal number that is not larger than max_value. Returns false if the string is not a number or is too large.
+ */
+bool ParseUnsignedNumber(const Opal::StringUtf8& str, u64 max_value, u64& out_value)
+{
+    if (str.IsEmpty())
+    {
+        return false;
+    }
+    u64 value = 0;
+    for (u64 i = 0; i < str.GetSize(); i++)
+    {
+        const char c = str.GetData()[i];
+        if (c < '0' || c > '9')
+        {
+            return false;
+        }
+        const u64 digit = static_cast<u64>(c - '0');
+        if (value > (max_value - digit) / 10)
+        {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    out_value = value;
+    return true;
+}
+
 ObsidianArguments ParseAndValidateArguments(int argc, const char** argv)
 {
     ObsidianArguments arguments;
@@ -704,7 +1648,34 @@ ObsidianArguments ParseAndValidateArguments(int argc, const char** argv)
         .AddArgument("log-level", "Control verbosity of logs", Opal::Ref{arguments.log_level}, true,
                      Opal::HashMap<Opal::StringUtf8, Opal::LogLevel>{
                          {"verbose", Opal::LogLevel::Verbose}, {"info", Opal::LogLevel::Info}, {"error", Opal::LogLevel::Error}})
-        .AddArgument("dump-ast", "Dump the extracted AST metadata", Opal::Ref{arguments.should_dump_ast}, true);
+        .AddArgument("dump-ast", "Dump the extracted AST metadata", Opal::Ref{arguments.should_dump_ast}, true)
+        .AddArgument("prelude", "Header with includes shared by all input files, precompiled once and reused by all of them",
+                     Opal::Ref{arguments.prelude_file}, true)
+        .AddArgument("prescan", "Skip input files that don't contain any reflection markers before parsing them",
+                     Opal::Ref{arguments.should_prescan}, true)
+        .AddArgument("jobs", "Number of worker threads, or 'auto' to use all processors available to the process",
+                     Opal::Ref{arguments.jobs}, true)
+        .AddArgument("memory-budget", "Limit concurrent translation units so that they fit in this many megabytes",
+                     Opal::Ref{arguments.memory_budget}, true)
+        .AddArgument("depfile", "Write a Make style depfile listing all headers the generated code depends on", Opal::Ref{arguments.depfile},
+                     true)
+        .AddArgument("cache-file", "Path to the cache file, by default obs.cache in the output directory", Opal::Ref{arguments.cache_file},
+                     true)
+        .AddArgument("dump-cache", "Write contents of the cache as JSON to the given path, for debugging", Opal::Ref{arguments.dump_cache},
+                     true)
+        .AddArgument("keep-going", "Keep compiling after a file fails to compile and report all failing files at the end",
+                     Opal::Ref{arguments.keep_going}, true)
+        .AddArgument("separate-files", "Generate one header per input header instead of a single reflection.hpp",
+                     Opal::Ref{arguments.use_separate_files}, true)
+        .AddArgument("unity", "Parse input files in batches, one translation unit per worker thread", Opal::Ref{arguments.use_unity_build},
+                     true)
+        .AddArgument("parse-profile", "How much of the input files to parse", Opal::Ref{arguments.parse_profile}, true,
+                     Opal::HashMap<Opal::StringUtf8, ParseProfile>{{"full", ParseProfile::Full}, {"reflection", ParseProfile::Reflection}})
+        .AddArgument("traversal", "Which parts of the AST to visit when looking for reflected types", Opal::Ref{arguments.traversal_mode},
+                     true,
+                     Opal::HashMap<Opal::StringUtf8, TraversalMode>{{"full", TraversalMode::Full},
+                                                                    {"skip-system", TraversalMode::SkipSystemHeaders},
+                                                                    {"inputs-only", TraversalMode::InputsOnly}});
     builder.Build(argv, static_cast<Opal::u32>(argc));
 
     if (!arguments.input_files.IsEmpty() && !arguments.input_dirs.IsEmpty())
@@ -756,6 +1727,38 @@ ObsidianArguments ParseAndValidateArguments(int argc, const char** argv)
     {
         throw ArgumentValidationException("Output directory does not exist - " + arguments.output_dir);
     }
+    if (arguments.cache_file.IsEmpty())
+    {
+        arguments.cache_file = Opal::Paths::Combine(arguments.output_dir, "obs.cache");
+    }
+    if (!arguments.prelude_file.IsEmpty() && !Opal::IsFile(arguments.prelude_file))
+    {
+        throw ArgumentValidationException("Prelude file does not exist - " + arguments.prelude_file);
+    }
+    if (arguments.jobs == "auto")
+    {
+        arguments.job_count = GetAvailableProcessorCount();
+    }
+    else
+    {
+        u64 job_count = 0;
+        if (!ParseUnsignedNumber(arguments.jobs, k_max_job_count, job_count) || job_count == 0)
+        {
+            throw ArgumentValidationException(
+                Opal::Format("Number of jobs must be 'auto' or a number between 1 and {} - {}", k_max_job_count, *arguments.jobs));
+        }
+        arguments.job_count = static_cast<u32>(job_count);
+    }
+    if (!arguments.memory_budget.IsEmpty())
+    {
+        u64 memory_budget_mb = 0;
+        if (!ParseUnsignedNumber(arguments.memory_budget, k_max_memory_budget_mb, memory_budget_mb) || memory_budget_mb == 0)
+        {
+            throw ArgumentValidationException(Opal::Format("Memory budget must be a number of megabytes between 1 and {} - {}",
+                                                           k_max_memory_budget_mb, *arguments.memory_budget));
+        }
+        arguments.memory_budget_bytes = memory_budget_mb * 1024 * 1024;
+    }
     for (const auto& dir : arguments.include_directories)
     {
         if (!Opal::Exists(dir))
@@ -768,11 +1771,24 @@ ObsidianArguments ParseAndValidateArguments(int argc, const char** argv)
     return arguments;
 }
 
+void LogParallelPhaseStats(const char* phase, const ParallelPhaseStats& stats)
+{
+    if (stats.worker_count == 0 || stats.duration <= 0.0f)
+    {
+        return;
+    }
+    const f32 efficiency = 100.0f * stats.work_duration / (stats.duration * static_cast<f32>(stats.worker_count));
+    Opal::GetLogger().Info("Obsidian", "{} work: {:.3f} seconds on {} workers, parallel efficiency {:.0f}%", phase, stats.work_duration,
+                           stats.worker_count, efficiency);
+    Opal::GetLogger().Info("Obsidian", "{} critical path: {} took {:.3f} seconds", phase, *stats.longest_item, stats.longest_item_duration);
+}
+
 int main(int argc, const char** argv)
 {
     auto program_start_time = Opal::GetSeconds();
 
-    Opal::MallocAllocator main_allocator;
+    Opal::MallocAllocator malloc_allocator;
+    CountingAllocator main_allocator(&malloc_allocator);
     Opal::PushDefaultAllocator(&main_allocator);
 
     Opal::Logger logger;
@@ -783,6 +1799,7 @@ int main(int argc, const char** argv)
     Opal::SetLogger(&logger);
 
     CppContext context;
+    context.allocation_counter = &main_allocator;
     try
     {
         ObsidianArguments arguments = ParseAndValidateArguments(argc, argv);
@@ -812,8 +1829,23 @@ int main(int argc, const char** argv)
     Opal::GetLogger().Info("Obsidian", "Processed {} files", context.input_files.GetSize());
     Opal::GetLogger().Info("Obsidian", "Program duration: {:.2f} seconds", program_end_time - program_start_time);
     Opal::GetLogger().Info("Obsidian", "Cache duration: {:.2f} seconds", context.cache_duration);
+    LogParallelPhaseStats("Hashing", context.hashing_stats);
+    Opal::GetLogger().Info("Obsidian", "Pre-scan duration: {:.2f} seconds", context.prescan_duration);
+    Opal::GetLogger().Info("Obsidian", "Prelude duration: {:.2f} seconds", context.prelude_duration);
     Opal::GetLogger().Info("Obsidian", "Compilation duration: {:.2f} seconds", context.compilation_duration);
-    Opal::GetLogger().Info("Obsidian", "Generation duration: {:.2f} seconds", context.generation_duration);
+    LogParallelPhaseStats("Compilation", context.compilation_stats);
+    Opal::GetLogger().Info("Obsidian", "Visited {} AST cursors, pruned {} subtrees", context.visited_cursor_count,
+                           context.pruned_cursor_count);
+    Opal::GetLogger().Info("Obsidian", "Peak memory usage: {:.2f} MB", static_cast<f64>(GetPeakMemoryUsage()) / (1024.0 * 1024.0));
+    Opal::GetLogger().Info("Obsidian", "Generation duration: {:.3f} seconds", context.generation_duration);
+    LogParallelPhaseStats("Generation", context.generation_stats);
+    Opal::GetLogger().Info("Obsidian", "Compilation allocations: {} ({:.2f} MB)", context.compilation_allocations.allocation_count,
+                           static_cast<f64>(context.compilation_allocations.allocated_bytes) / (1024.0 * 1024.0));
+    Opal::GetLogger().Info("Obsidian", "Generation allocations: {} ({:.2f} MB), arena allocations: {} ({:.2f} MB)",
+                           context.generation_allocations.allocation_count,
+                           static_cast<f64>(context.generation_allocations.allocated_bytes) / (1024.0 * 1024.0),
+                           context.generation_arena_allocations.allocation_count,
+                           static_cast<f64>(context.generation_arena_allocations.allocated_bytes) / (1024.0 * 1024.0));
 
     return 0;
 }
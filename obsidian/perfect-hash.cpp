@@ -0,0 +1,206 @@
+#include "perfect-hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr u64 k_fnv_offset_basis = 0xCBF29CE484222325ull;
+static constexpr u64 k_fnv_prime = 0x100000001B3ull;
+// Displacements tried per bucket before the build is restarted with another seed.
+static constexpr u32 k_max_displacement = 1u << 20;
+
+u64 HashName(const char* name, u64 size, u64 seed)
+{
+    u64 hash = k_fnv_offset_basis ^ seed;
+    for (u64 i = 0; i < size; i++)
+    {
+        hash ^= static_cast<u8>(name[i]);
+        hash *= k_fnv_prime;
+    }
+    return hash;
+}
+
+u64 HashName(const char* name, u64 seed)
+{
+    return HashName(name, strlen(name), seed);
+}
+
+u64 MixNameHash(u64 hash, u32 displacement)
+{
+    // SplitMix64 finalizer.
+    hash += static_cast<u64>(displacement) * 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+u32 PerfectHash::Find(const char* name) const
+{
+    if (slots.IsEmpty())
+    {
+        return k_not_found;
+    }
+    const u64 hash = HashName(name, seed);
+    const u32 displacement = displacements[hash % displacements.GetSize()];
+    if ((displacement & k_direct_slot) != 0)
+    {
+        return slots[displacement & ~k_direct_slot];
+    }
+    return slots[MixNameHash(hash, displacement) % slots.GetSize()];
+}
+
+/**
+ * Try to place all keys with the given seed. Returns false if some bucket can't be placed, the caller then retries with another
+ * seed.
+ */
+static bool TryBuildPerfectHash(PerfectHash& out, const Opal::DynamicArray<const Opal::StringUtf8*>& names,
+                                const Opal::DynamicArray<u32>& keys, u64 seed)
+{
+    const u64 key_count = keys.GetSize();
+    // Two keys per bucket on average. Larger buckets are placed first, while most slots are still free.
+    const u64 bucket_count = key_count / 2 + 1;
+
+    Opal::DynamicArray<u64> hashes;
+    hashes.Resize(key_count);
+    Opal::DynamicArray<u32> bucket_sizes;
+    bucket_sizes.Resize(bucket_count);
+    for (u64 i = 0; i < bucket_count; i++)
+    {
+        bucket_sizes[i] = 0;
+    }
+    for (u64 i = 0; i < key_count; i++)
+    {
+        const Opal::StringUtf8& name = *names[keys[i]];
+        hashes[i] = HashName(name.GetData(), name.GetSize(), seed);
+        bucket_sizes[hashes[i] % bucket_count]++;
+    }
+
+    // Keys grouped by bucket, bucket_starts[b] is the first key of bucket b in bucket_keys.
+    Opal::DynamicArray<u32> bucket_starts;
+    bucket_starts.Resize(bucket_count + 1);
+    bucket_starts[0] = 0;
+    for (u64 i = 0; i < bucket_count; i++)
+    {
+        bucket_starts[i + 1] = bucket_starts[i] + bucket_sizes[i];
+    }
+    Opal::DynamicArray<u32> bucket_keys;
+    bucket_keys.Resize(key_count);
+    Opal::DynamicArray<u32> bucket_fill;
+    bucket_fill.Resize(bucket_count);
+    for (u64 i = 0; i < bucket_count; i++)
+    {
+        bucket_fill[i] = bucket_starts[i];
+    }
+    for (u64 i = 0; i < key_count; i++)
+    {
+        bucket_keys[bucket_fill[hashes[i] % bucket_count]++] = static_cast<u32>(i);
+    }
+
+    Opal::DynamicArray<u32> bucket_order;
+    bucket_order.Resize(bucket_count);
+    for (u64 i = 0; i < bucket_count; i++)
+    {
+        bucket_order[i] = static_cast<u32>(i);
+    }
+    std::sort(bucket_order.GetData(), bucket_order.GetData() + bucket_count,
+              [&bucket_sizes](u32 a, u32 b) { return bucket_sizes[a] != bucket_sizes[b] ? bucket_sizes[a] > bucket_sizes[b] : a < b; });
+
+    out.seed = seed;
+    out.displacements.Resize(bucket_count);
+    out.slots.Resize(key_count);
+    for (u64 i = 0; i < bucket_count; i++)
+    {
+        out.displacements[i] = 0;
+    }
+    for (u64 i = 0; i < key_count; i++)
+    {
+        out.slots[i] = PerfectHash::k_not_found;
+    }
+
+    Opal::DynamicArray<u64> candidate_slots;
+    u64 next_free_slot = 0;
+    for (u32 bucket : bucket_order)
+    {
+        const u32 size = bucket_sizes[bucket];
+        const u32* bucket_begin = bucket_keys.GetData() + bucket_starts[bucket];
+        if (size == 0)
+        {
+            break;
+        }
+        if (size == 1)
+        {
+            while (out.slots[next_free_slot] != PerfectHash::k_not_found)
+            {
+                next_free_slot++;
+            }
+            out.displacements[bucket] = PerfectHash::k_direct_slot | static_cast<u32>(next_free_slot);
+            out.slots[next_free_slot] = keys[bucket_begin[0]];
+            continue;
+        }
+
+        bool placed = false;
+        for (u32 displacement = 0; displacement < k_max_displacement && !placed; displacement++)
+        {
+            candidate_slots.Clear();
+            placed = true;
+            for (u32 i = 0; i < size && placed; i++)
+            {
+                const u64 slot = MixNameHash(hashes[bucket_begin[i]], displacement) % key_count;
+                placed = out.slots[slot] == PerfectHash::k_not_found &&
+                         std::find(candidate_slots.begin(), candidate_slots.end(), slot) == candidate_slots.end();
+                candidate_slots.PushBack(slot);
+            }
+            if (placed)
+            {
+                out.displacements[bucket] = displacement;
+                for (u32 i = 0; i < size; i++)
+                {
+                    out.slots[candidate_slots[i]] = keys[bucket_begin[i]];
+                }
+            }
+        }
+        if (!placed)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+PerfectHash BuildPerfectHash(const Opal::DynamicArray<const Opal::StringUtf8*>& names)
+{
+    // Sort indices by name and keep the first index of every name.
+    Opal::DynamicArray<u32> sorted;
+    sorted.Resize(names.GetSize());
+    for (u64 i = 0; i < names.GetSize(); i++)
+    {
+        sorted[i] = static_cast<u32>(i);
+    }
+    std::sort(sorted.GetData(), sorted.GetData() + sorted.GetSize(),
+              [&names](u32 a, u32 b)
+              {
+                  const int result = strcmp(names[a]->GetData(), names[b]->GetData());
+                  return result != 0 ? result < 0 : a < b;
+              });
+    Opal::DynamicArray<u32> keys;
+    for (u64 i = 0; i < sorted.GetSize(); i++)
+    {
+        if (i == 0 || *names[sorted[i]] != *names[sorted[i - 1]])
+        {
+            keys.PushBack(sorted[i]);
+        }
+    }
+
+    PerfectHash result;
+    if (keys.IsEmpty())
+    {
+        return result;
+    }
+    // A new seed changes every hash, so even names whose hashes collide end up in different slots.
+    for (u64 seed = 0;; seed++)
+    {
+        if (TryBuildPerfectHash(result, names, keys, seed))
+        {
+            return result;
+        }
+    }
+}
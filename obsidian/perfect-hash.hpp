@@ -0,0 +1,46 @@
+#pragma once
+
+#include "types.hpp"
+
+/**
+ * Minimal perfect hash of a set of names, built with the hash and displace (CHD) algorithm. The hash of a name picks a bucket
+ * and the displacement of that bucket is mixed into the hash to pick a slot. Displacements are chosen so that every name gets
+ * its own slot, so a lookup is one hash and one compare with the name stored in the slot. Buckets with a single name store
+ * the slot directly.
+ *
+ * Generated reflection code does the same lookup, see Impl::FindByName in k_reflection_definitions_template, so both sides
+ * have to agree on the functions below.
+ */
+struct PerfectHash
+{
+    static constexpr u32 k_not_found = ~0u;
+    // Displacements with this bit set are the slot itself.
+    static constexpr u32 k_direct_slot = 0x80000000u;
+
+    u64 seed = 0;
+    Opal::DynamicArray<u32> displacements;
+    // Index of the name in the input array for every slot.
+    Opal::DynamicArray<u32> slots;
+
+    /**
+     * Index of the only name that can be equal to `name`, or k_not_found if there are no names. Caller has to compare the names.
+     */
+    [[nodiscard]] u32 Find(const char* name) const;
+};
+
+/**
+ * FNV-1a hash of a name, the seed is mixed into the offset basis.
+ */
+u64 HashName(const char* name, u64 size, u64 seed);
+u64 HashName(const char* name, u64 seed);
+
+/**
+ * Hash that picks the slot of a name in a bucket with the given displacement.
+ */
+u64 MixNameHash(u64 hash, u32 displacement);
+
+/**
+ * Build a minimal perfect hash of the names. If a name appears more than once only its first occurrence can be found, same as
+ * with a linear search.
+ */
+PerfectHash BuildPerfectHash(const Opal::DynamicArray<const Opal::StringUtf8*>& names);
@@ -0,0 +1,49 @@
+#include "prescan.hpp"
+
+#include <cstring>
+
+#include "mapped-file.hpp"
+
+static constexpr const char k_marker_prefix[] = "OBS_";
+static constexpr u64 k_marker_prefix_size = sizeof(k_marker_prefix) - 1;
+
+static bool IsMarkerAt(const char* data, u64 remaining_size, const char* marker)
+{
+    const u64 marker_size = strlen(marker);
+    return remaining_size >= marker_size && memcmp(data, marker, marker_size) == 0;
+}
+
+bool HasReflectionMarkers(const Opal::StringUtf8& file_path)
+{
+    const MappedFile file(file_path);
+    if (!file.IsValid())
+    {
+        return true;
+    }
+
+    // memchr is vectorized by every C runtime we care about, so jump between candidate positions with it instead of comparing
+    // byte by byte.
+    const char* data = file.GetData();
+    const char* end = data + file.GetSize();
+    while (data < end)
+    {
+        const auto* candidate = static_cast<const char*>(memchr(data, k_marker_prefix[0], static_cast<size_t>(end - data)));
+        if (candidate == nullptr)
+        {
+            return false;
+        }
+        const u64 remaining_size = static_cast<u64>(end - candidate);
+        if (remaining_size >= k_marker_prefix_size && memcmp(candidate, k_marker_prefix, k_marker_prefix_size) == 0)
+        {
+            const char* name = candidate + k_marker_prefix_size;
+            const u64 name_size = remaining_size - k_marker_prefix_size;
+            // OBS_PROP on its own can't produce any reflection data since it needs to be inside of an OBS_CLASS.
+            if (IsMarkerAt(name, name_size, "ENUM") || IsMarkerAt(name, name_size, "CLASS"))
+            {
+                return true;
+            }
+        }
+        data = candidate + 1;
+    }
+    return false;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "types.hpp"
+
+/**
+ * Cheap textual check that tells if the file can contain any reflected types. It looks for the OBS_ENUM and OBS_CLASS markers
+ * without running the preprocessor, so commented out markers still count. If the file can't be read it is assumed to contain
+ * markers so that the parser gets to report the problem.
+ */
+bool HasReflectionMarkers(const Opal::StringUtf8& file_path);
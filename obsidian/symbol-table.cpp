@@ -0,0 +1,92 @@
+#include "symbol-table.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "opal/container/hash-set.h"
+#include "opal/paths.h"
+
+bool SymbolTable::ContainsEnum(const Opal::StringUtf8& full_name)
+{
+    Shard& shard = GetShard(full_name);
+    std::lock_guard lock(shard.mutex);
+    return shard.enum_defining_files.Contains(full_name);
+}
+
+bool SymbolTable::ContainsClass(const Opal::StringUtf8& full_name)
+{
+    Shard& shard = GetShard(full_name);
+    std::lock_guard lock(shard.mutex);
+    return shard.class_defining_files.Contains(full_name);
+}
+
+bool SymbolTable::InsertEnum(CppEnum&& cpp_enum, const Opal::StringUtf8& defining_file)
+{
+    Shard& shard = GetShard(cpp_enum.full_name);
+    std::lock_guard lock(shard.mutex);
+    if (shard.enum_defining_files.Contains(cpp_enum.full_name))
+    {
+        Opal::GetLogger().Verbose("Obsidian", "Enum {} from {} already defined by {}", *cpp_enum.full_name, *defining_file,
+                                  *shard.enum_defining_files[cpp_enum.full_name]);
+        return false;
+    }
+    Opal::GetLogger().Verbose("Obsidian", "Enum {} first defined by {}", *cpp_enum.full_name, *defining_file);
+    shard.enum_defining_files.Insert(cpp_enum.full_name.Clone(), defining_file.Clone());
+    shard.enums.PushBack(std::move(cpp_enum));
+    return true;
+}
+
+bool SymbolTable::InsertClass(CppClass&& cpp_class, const Opal::StringUtf8& defining_file)
+{
+    Shard& shard = GetShard(cpp_class.full_name);
+    std::lock_guard lock(shard.mutex);
+    if (shard.class_defining_files.Contains(cpp_class.full_name))
+    {
+        Opal::GetLogger().Verbose("Obsidian", "Class {} from {} already defined by {}", *cpp_class.full_name, *defining_file,
+                                  *shard.class_defining_files[cpp_class.full_name]);
+        return false;
+    }
+    Opal::GetLogger().Verbose("Obsidian", "Class {} first defined by {}", *cpp_class.full_name, *defining_file);
+    shard.class_defining_files.Insert(cpp_class.full_name.Clone(), defining_file.Clone());
+    shard.classes.PushBack(std::move(cpp_class));
+    return true;
+}
+
+void SymbolTable::MoveTo(CppContext& context)
+{
+    Opal::HashSet<Opal::StringUtf8> files_to_include;
+    for (Shard& shard : m_shards)
+    {
+        std::lock_guard lock(shard.mutex);
+        for (auto& cpp_enum : shard.enums)
+        {
+            files_to_include.Insert(Opal::Paths::NormalizePath(cpp_enum.containing_file_path));
+            context.enums.PushBack(std::move(cpp_enum));
+        }
+        for (auto& cpp_class : shard.classes)
+        {
+            files_to_include.Insert(Opal::Paths::NormalizePath(cpp_class.containing_file_path));
+            context.classes.PushBack(std::move(cpp_class));
+        }
+        shard.enums.Clear();
+        shard.classes.Clear();
+    }
+    for (const auto& path : files_to_include)
+    {
+        context.files_to_include.PushBack(path.Clone());
+    }
+
+    // Shard order depends on hashes, sort everything so that the generated code doesn't change between runs.
+    const auto compare_names = [](const Opal::StringUtf8& a, const Opal::StringUtf8& b) { return strcmp(a.GetData(), b.GetData()) < 0; };
+    std::sort(context.enums.GetData(), context.enums.GetData() + context.enums.GetSize(),
+              [&compare_names](const CppEnum& a, const CppEnum& b) { return compare_names(a.full_name, b.full_name); });
+    std::sort(context.classes.GetData(), context.classes.GetData() + context.classes.GetSize(),
+              [&compare_names](const CppClass& a, const CppClass& b) { return compare_names(a.full_name, b.full_name); });
+    std::sort(context.files_to_include.GetData(), context.files_to_include.GetData() + context.files_to_include.GetSize(), compare_names);
+}
+
+SymbolTable::Shard& SymbolTable::GetShard(const Opal::StringUtf8& full_name)
+{
+    constexpr Opal::Hasher<Opal::StringUtf8> hasher;
+    return m_shards[hasher(full_name) % k_shard_count];
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+
+#include "opal/container/hash-map.h"
+
+#include "types.hpp"
+
+/**
+ * Table of reflected types shared by all worker threads, keyed by the fully qualified name of the type. The first definition
+ * of a type wins and later ones are discarded, the table remembers which file the winning definition came from. The table is
+ * split into shards, each protected by its own lock, so that workers inserting different types rarely wait for each other.
+ */
+class SymbolTable
+{
+public:
+    /**
+     * Check if the type is already in the table. Used to skip extracting data for types that were already seen in another
+     * translation unit.
+     */
+    bool ContainsEnum(const Opal::StringUtf8& full_name);
+    bool ContainsClass(const Opal::StringUtf8& full_name);
+
+    /**
+     * Add the type to the table. Returns false if the type was already defined, in which case the table is not modified.
+     * @param defining_file File whose translation unit produced this type.
+     */
+    bool InsertEnum(CppEnum&& cpp_enum, const Opal::StringUtf8& defining_file);
+    bool InsertClass(CppClass&& cpp_class, const Opal::StringUtf8& defining_file);
+
+    /**
+     * Move all types to the context, sorted by their full name, and collect the files that need to be included by the
+     * generated code. Names stay in the table so types that were moved out still can't be inserted again.
+     */
+    void MoveTo(CppContext& context);
+
+private:
+    static constexpr u64 k_shard_count = 16;
+
+    struct Shard
+    {
+        std::mutex mutex;
+        Opal::HashMap<Opal::StringUtf8, Opal::StringUtf8> enum_defining_files;
+        Opal::HashMap<Opal::StringUtf8, Opal::StringUtf8> class_defining_files;
+        Opal::DynamicArray<CppEnum> enums;
+        Opal::DynamicArray<CppClass> classes;
+    };
+
+    Shard& GetShard(const Opal::StringUtf8& full_name);
+
+    Shard m_shards[k_shard_count];
+};
@@ -0,0 +1,243 @@
+#include "system.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+u64 GetPeakMemoryUsage()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == 0)
+    {
+        return 0;
+    }
+    return static_cast<u64>(counters.PeakWorkingSetSize);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<u64>(usage.ru_maxrss);
+#else
+    // Linux reports the value in kilobytes.
+    return static_cast<u64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+#if defined(__linux__)
+/**
+ * Returns the number of processors allowed by the CFS quota of the cgroup, rounded up, or 0 if there is no quota. Containers
+ * see their own cgroup mounted at the root of /sys/fs/cgroup, which is where CI runners apply their CPU limits.
+ */
+static u32 GetCgroupCpuLimit()
+{
+    long long quota = -1;
+    long long period = 0;
+    // cgroup v2 stores both values in a single file, "max" means there is no limit.
+    if (FILE* file = fopen("/sys/fs/cgroup/cpu.max", "r"))
+    {
+        char quota_str[32] = {};
+        if (fscanf(file, "%31s %lld", quota_str, &period) == 2 && strcmp(quota_str, "max") != 0)
+        {
+            quota = strtoll(quota_str, nullptr, 10);
+        }
+        fclose(file);
+    }
+    else
+    {
+        const char* quota_paths[] = {"/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "/sys/fs/cgroup/cpu,cpuacct/cpu.cfs_quota_us"};
+        const char* period_paths[] = {"/sys/fs/cgroup/cpu/cpu.cfs_period_us", "/sys/fs/cgroup/cpu,cpuacct/cpu.cfs_period_us"};
+        for (u32 i = 0; i < 2 && quota <= 0; i++)
+        {
+            FILE* quota_file = fopen(quota_paths[i], "r");
+            FILE* period_file = fopen(period_paths[i], "r");
+            if (quota_file != nullptr && period_file != nullptr)
+            {
+                if (fscanf(quota_file, "%lld", &quota) != 1 || fscanf(period_file, "%lld", &period) != 1)
+                {
+                    quota = -1;
+                }
+            }
+            if (quota_file != nullptr)
+            {
+                fclose(quota_file);
+            }
+            if (period_file != nullptr)
+            {
+                fclose(period_file);
+            }
+        }
+    }
+    if (quota <= 0 || period <= 0)
+    {
+        return 0;
+    }
+    return static_cast<u32>((quota + period - 1) / period);
+}
+#endif
+
+u32 GetAvailableProcessorCount()
+{
+    u32 count = 0;
+#if defined(_WIN32)
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) != 0)
+    {
+        for (; process_mask != 0; process_mask &= process_mask - 1)
+        {
+            count++;
+        }
+    }
+#elif defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+    {
+        count = static_cast<u32>(CPU_COUNT(&cpu_set));
+    }
+    const u32 cgroup_limit = GetCgroupCpuLimit();
+    if (cgroup_limit > 0 && (count == 0 || cgroup_limit < count))
+    {
+        count = cgroup_limit;
+    }
+#endif
+    if (count == 0)
+    {
+        count = std::thread::hardware_concurrency();
+    }
+    return count > 0 ? count : 1;
+}
+
+u64 GetFileSizeInBytes(const Opal::StringUtf8& file_path)
+{
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (GetFileAttributesExA(*file_path, GetFileExInfoStandard, &attributes) == 0)
+    {
+        return 0;
+    }
+    return (static_cast<u64>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+#else
+    struct stat file_stat;
+    if (stat(*file_path, &file_stat) != 0)
+    {
+        return 0;
+    }
+    return static_cast<u64>(file_stat.st_size);
+#endif
+}
+
+u32 GetProcessIdentifier()
+{
+#if defined(_WIN32)
+    return static_cast<u32>(GetCurrentProcessId());
+#else
+    return static_cast<u32>(getpid());
+#endif
+}
+
+bool RenameFileReplacingExisting(const Opal::StringUtf8& from_path, const Opal::StringUtf8& to_path)
+{
+#if defined(_WIN32)
+    return MoveFileExA(*from_path, *to_path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(*from_path, *to_path) == 0;
+#endif
+}
+
+FileLock::~FileLock()
+{
+    Release();
+}
+
+bool FileLock::Acquire(const Opal::StringUtf8& lock_file_path)
+{
+    Release();
+#if defined(_WIN32)
+    HANDLE file_handle = CreateFileA(*lock_file_path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                     nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    OVERLAPPED overlapped = {};
+    if (LockFileEx(file_handle, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped) == 0)
+    {
+        Opal::GetLogger().Info("Obsidian", "Waiting for another instance to release {}", *lock_file_path);
+        if (LockFileEx(file_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped) == 0)
+        {
+            CloseHandle(file_handle);
+            return false;
+        }
+    }
+    m_file_handle = file_handle;
+#else
+    const int file_descriptor = open(*lock_file_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (file_descriptor < 0)
+    {
+        return false;
+    }
+    if (flock(file_descriptor, LOCK_EX | LOCK_NB) != 0)
+    {
+        Opal::GetLogger().Info("Obsidian", "Waiting for another instance to release {}", *lock_file_path);
+        if (flock(file_descriptor, LOCK_EX) != 0)
+        {
+            close(file_descriptor);
+            return false;
+        }
+    }
+    m_file_descriptor = file_descriptor;
+#endif
+    return true;
+}
+
+void FileLock::Release()
+{
+#if defined(_WIN32)
+    if (m_file_handle != nullptr)
+    {
+        OVERLAPPED overlapped = {};
+        UnlockFileEx(m_file_handle, 0, 1, 0, &overlapped);
+        CloseHandle(m_file_handle);
+        m_file_handle = nullptr;
+    }
+#else
+    if (m_file_descriptor >= 0)
+    {
+        flock(m_file_descriptor, LOCK_UN);
+        close(m_file_descriptor);
+        m_file_descriptor = -1;
+    }
+#endif
+}
+
+bool FileLock::IsAcquired() const
+{
+#if defined(_WIN32)
+    return m_file_handle != nullptr;
+#else
+    return m_file_descriptor >= 0;
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "types.hpp"
+
+/**
+ * Returns the peak resident memory of the process so far, in bytes. Returns 0 if the platform doesn't provide it.
+ */
+u64 GetPeakMemoryUsage();
+
+/**
+ * Returns the number of logical processors this process is allowed to run on. Takes into account the affinity mask of the
+ * process and, on Linux, the CPU quota of the cgroup the process runs in. Always returns at least 1.
+ */
+u32 GetAvailableProcessorCount();
+
+/**
+ * Returns the size of the file in bytes, or 0 if the file doesn't exist.
+ */
+u64 GetFileSizeInBytes(const Opal::StringUtf8& file_path);
+
+/**
+ * Returns the identifier of the current process.
+ */
+u32 GetProcessIdentifier();
+
+/**
+ * Rename the file, replacing the destination if it already exists. Readers of the destination see either the old or the new
+ * file, never a partially written one. Returns false if the file can't be renamed.
+ */
+bool RenameFileReplacingExisting(const Opal::StringUtf8& from_path, const Opal::StringUtf8& to_path);
+
+/**
+ * Exclusive advisory lock on a file, used to serialize Obsidian instances that share the same files. The lock file is created
+ * if it doesn't exist. The lock is released when the object is destroyed or when the process exits.
+ */
+class FileLock
+{
+public:
+    FileLock() = default;
+    ~FileLock();
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+    /**
+     * Block until the lock is acquired. Returns false if the lock file can't be opened or locked.
+     */
+    bool Acquire(const Opal::StringUtf8& lock_file_path);
+    void Release();
+
+    [[nodiscard]] bool IsAcquired() const;
+
+private:
+#if defined(_WIN32)
+    void* m_file_handle = nullptr;
+#else
+    int m_file_descriptor = -1;
+#endif
+};
@@ -7,8 +7,9 @@ constexpr const char* k_reflection_header_template = R"(// AUTO-GENERATED. DO NO
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
-#include <vector>
 
 #include "opal/allocator.h"
 
@@ -17,16 +18,107 @@ __refl_includes__
 namespace Obs
 {
 
+__refl_definitions__
+#pragma region Compile-Time Enum Reflection
+
+__refl_enum__
+
+#pragma endregion
+
+#pragma region Compile-Time Class Reflection
+
+__refl_class__
+
+#pragma endregion
+
+#pragma region Run-Time Enum Reflection
+
+__refl_enum_collection__
+
+#pragma endregion
+
+#pragma region Run-Time Class Reflection
+
+__refl_class_collection__
+
+#pragma endregion
+
+} // namespace Obs
+)";
+
+// Types shared by all generated headers, the same in every output.
+constexpr const char* k_reflection_definitions_template = R"(/**
+ * Read-only view of a constant table. Tables are constexpr arrays, so they don't need to be constructed at startup.
+ */
+template <typename T>
+struct Span
+{
+    const T* data = nullptr;
+    size_t count = 0;
+
+    constexpr size_t size() const { return count; }
+    constexpr bool empty() const { return count == 0; }
+    constexpr const T& operator[](size_t index) const { return data[index]; }
+    constexpr const T* begin() const { return data; }
+    constexpr const T* end() const { return data + count; }
+};
+
 struct Attribute
 {
     const char* name;
     const char* value;
 };
 
+/**
+ * Minimal perfect hash of the names in a table, computed by Obsidian. Hash of a name picks a bucket, the displacement of the
+ * bucket picks the slot and the slot holds the index of the only entry that can have that name.
+ */
+struct NameIndex
+{
+    uint64_t seed = 0;
+    Span<uint32_t> displacements;
+    Span<uint32_t> slots;
+};
+
 namespace Impl
 {
 
-inline bool HasAttribute(const std::vector<Attribute>& attributes, const char* name)
+inline uint64_t HashName(const char* name, uint64_t seed)
+{
+    uint64_t hash = 0xCBF29CE484222325ull ^ seed;
+    for (; *name != 0; name++)
+    {
+        hash ^= static_cast<uint8_t>(*name);
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+inline uint64_t MixNameHash(uint64_t hash, uint32_t displacement)
+{
+    hash += static_cast<uint64_t>(displacement) * 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+template <typename T>
+inline const T* FindByName(Span<T> table, const NameIndex& index, const char* name)
+{
+    if (index.slots.empty())
+    {
+        return nullptr;
+    }
+    const uint64_t hash = HashName(name, index.seed);
+    const uint32_t displacement = index.displacements[hash % index.displacements.size()];
+    // Buckets with a single name store their slot directly.
+    const uint64_t slot =
+        (displacement & 0x80000000u) != 0 ? displacement & 0x7FFFFFFFu : MixNameHash(hash, displacement) % index.slots.size();
+    const T& entry = table[index.slots[slot]];
+    return strcmp(entry.name, name) == 0 ? &entry : nullptr;
+}
+
+inline bool HasAttribute(Span<Attribute> attributes, const char* name)
 {
     for (const auto& attr : attributes)
     {
@@ -35,7 +127,7 @@ inline bool HasAttribute(const std::vector<Attribute>& attributes, const char* n
     return false;
 }
 
-inline const char* GetAttributeValue(const std::vector<Attribute>& attributes, const char* name)
+inline const char* GetAttributeValue(Span<Attribute> attributes, const char* name)
 {
     for (const auto& attr : attributes)
     {
@@ -46,18 +138,12 @@ inline const char* GetAttributeValue(const std::vector<Attribute>& attributes, c
 
 } // namespace Impl
 
-#pragma region Compile-Time Enum Reflection
-
 template <typename T>
 struct Enum
 {
     static_assert(false, "Enum type does not have reflection data!");
 };
 
-__refl_enum__
-
-#pragma endregion
-
 struct EnumItem
 {
     const char* name = "";
@@ -71,19 +157,14 @@ struct EnumEntry
     const char* full_name = "";
     const char* description = "";
     int underlying_type_size = 0;
-    std::vector<EnumItem> items;
-    std::vector<Attribute> attributes;
+    Span<EnumItem> items;
+    Span<Attribute> attributes;
+    NameIndex item_index;
 
     bool HasAttribute(const char* attr_name) const { return Impl::HasAttribute(attributes, attr_name); }
     const char* GetAttributeValue(const char* attr_name) const { return Impl::GetAttributeValue(attributes, attr_name); }
 };
 
-#pragma region Run-Time Enum Reflection
-
-__refl_enum_collection__
-
-#pragma endregion
-
 struct Property
 {
     const char* name;
@@ -94,7 +175,7 @@ struct Property
     int size;
     void (*read)(const void* obj, void* out);
     void (*write)(void* obj, const void* in);
-    std::vector<Attribute> attributes;
+    Span<Attribute> attributes;
 
     bool HasAttribute(const char* attr_name) const { return Impl::HasAttribute(attributes, attr_name); }
     const char* GetAttributeValue(const char* attr_name) const { return Impl::GetAttributeValue(attributes, attr_name); }
@@ -110,25 +191,85 @@ struct ClassEntry
     int alignment;
     void* (*create)(Opal::AllocatorBase* allocator);
 
-    std::vector<Property> properties;
-    std::vector<Attribute> attributes;
+    Span<Property> properties;
+    Span<Attribute> attributes;
+    NameIndex property_index;
 
     bool HasAttribute(const char* attr_name) const { return Impl::HasAttribute(attributes, attr_name); }
     const char* GetAttributeValue(const char* attr_name) const { return Impl::GetAttributeValue(attributes, attr_name); }
 };
 
-#pragma region Compile-Time Class Reflection
-
 template <typename T>
 struct Class
 {
     static_assert(false, "Class type does not have reflection data!");
 };
+)";
+
+// Used when every input header gets its own generated header. Holds the shared types so that the per-header files don't
+// depend on each other.
+constexpr const char* k_reflection_core_template = R"(// AUTO-GENERATED. DO NOT CHANGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "opal/allocator.h"
+
+namespace Obs
+{
+
+__refl_definitions__
+} // namespace Obs
+)";
+
+// Compile-time reflection of the types declared in a single input header.
+constexpr const char* k_reflection_file_template = R"(// AUTO-GENERATED. DO NOT CHANGE.
+
+#pragma once
+
+#include "reflection-core.hpp"
+
+__refl_includes__
+
+namespace Obs
+{
+
+#pragma region Compile-Time Enum Reflection
+
+__refl_enum__
+
+#pragma endregion
+
+#pragma region Compile-Time Class Reflection
 
 __refl_class__
 
 #pragma endregion
 
+} // namespace Obs
+)";
+
+// Includes all per-header files and holds the run-time collections of all types.
+constexpr const char* k_reflection_aggregate_template = R"(// AUTO-GENERATED. DO NOT CHANGE.
+
+#pragma once
+
+#include "reflection-core.hpp"
+
+__refl_includes__
+
+namespace Obs
+{
+
+#pragma region Run-Time Enum Reflection
+
+__refl_enum_collection__
+
+#pragma endregion
+
 #pragma region Run-Time Class Reflection
 
 __refl_class_collection__
@@ -184,14 +325,15 @@ __enum_name_to_value_switch__
         return k_end;
     }
 
-    static const std::vector<Attribute>& GetAttributes()
-    {
-        static const std::vector<Attribute> s_attributes = {__enum_attributes__};
-        return s_attributes;
-    }
+    static constexpr Span<EnumItem> GetItems() { return k_items; }
+    static constexpr NameIndex GetItemIndex() { return k_item_index; }
+    static constexpr Span<Attribute> GetAttributes() { return k_attributes; }
 
     static bool HasAttribute(const char* attr_name) { return Impl::HasAttribute(GetAttributes(), attr_name); }
     static const char* GetAttributeValue(const char* attr_name) { return Impl::GetAttributeValue(GetAttributes(), attr_name); }
+
+private:
+__enum_tables__
 };
 )";
 
@@ -215,8 +357,8 @@ struct Class<__class_scoped_name__>
 	{
 		ConstIterator(const Class* cls, int position) : m_class(cls), m_pos(position) {}
 		bool operator==(const ConstIterator& other) const { return m_class == other.m_class && m_pos == other.m_pos; }
-		const Property& operator*() const { return m_class->m_properties[m_pos]; }
-        const Property* operator->() const { return &m_class->m_properties[m_pos]; }
+		const Property& operator*() const { return k_properties[m_pos]; }
+        const Property* operator->() const { return &k_properties[m_pos]; }
         ConstIterator operator++(int) { ConstIterator tmp = *this; m_pos++; return tmp; }
         ConstIterator& operator++() { m_pos++; return *this; }
 
@@ -229,7 +371,7 @@ struct Class<__class_scoped_name__>
 	};
 
     ConstIterator begin() const { return ConstIterator(this, 0); }
-    ConstIterator end() const { return ConstIterator(this, this->m_properties.size()); }
+    ConstIterator end() const { return ConstIterator(this, static_cast<int>(k_properties.size())); }
 
 	static bool Read(void* out_value, void* object, const char* property_name)
     {
@@ -237,15 +379,13 @@ struct Class<__class_scoped_name__>
         {
             return false;
         }
-        for (auto& prop : Get())
+        const Property* prop = Impl::FindByName(k_properties, k_property_index, property_name);
+        if (prop == nullptr)
         {
-            if (strcmp(prop.name, property_name) == 0)
-            {
-                prop.read(object, out_value);
-                return true;
-            }
+            return false;
         }
-        return false;
+        prop->read(object, out_value);
+        return true;
     }
 
     static bool Write(void* value, void* object, const char* property_name)
@@ -254,28 +394,24 @@ struct Class<__class_scoped_name__>
         {
             return false;
         }
-        for (auto& prop : Get())
+        const Property* prop = Impl::FindByName(k_properties, k_property_index, property_name);
+        if (prop == nullptr)
         {
-            if (strcmp(prop.name, property_name) == 0)
-            {
-                prop.write(object, value);
-                return true;
-            }
+            return false;
         }
-        return false;
+        prop->write(object, value);
+        return true;
     }
 
-    static const std::vector<Attribute>& GetAttributes()
-    {
-        static const std::vector<Attribute> s_attributes = {__class_attributes__};
-        return s_attributes;
-    }
+    static constexpr Span<Property> GetProperties() { return k_properties; }
+    static constexpr NameIndex GetPropertyIndex() { return k_property_index; }
+    static constexpr Span<Attribute> GetAttributes() { return k_attributes; }
 
     static bool HasAttribute(const char* attr_name) { return Impl::HasAttribute(GetAttributes(), attr_name); }
     static const char* GetAttributeValue(const char* attr_name) { return Impl::GetAttributeValue(GetAttributes(), attr_name); }
 
 private:
-	std::vector<Property> m_properties = __class_init_properties__;
+__class_tables__
 };
 )";
 
@@ -283,38 +419,33 @@ constexpr const char* k_enum_collection_template = R"(struct EnumCollection
 {
     static bool GetEnum(const char* enum_name, const EnumEntry*& out_entry)
     {
-        for (EnumEntry& entry : s_entries)
+        const EnumEntry* entry = Impl::FindByName(k_entries, k_index, enum_name);
+        if (entry == nullptr)
         {
-            if (strcmp(entry.name, enum_name) == 0)
-            {
-                out_entry = &entry;
-                return true;
-            }
+            return false;
         }
-        return false;
+        out_entry = entry;
+        return true;
     }
 
     static bool GetValue(void* out_value, const char* enum_name, const char* item_name)
     {
-        for (EnumEntry& enum_entry : s_entries)
+        const EnumEntry* enum_entry = Impl::FindByName(k_entries, k_index, enum_name);
+        if (enum_entry == nullptr)
         {
-            if (strcmp(enum_entry.name, enum_name) == 0)
-            {
-                for (EnumItem& item : enum_entry.items)
-                {
-                    if (strcmp(item.name, item_name) == 0)
-                    {
-                        memcpy(out_value, reinterpret_cast<const void*>(&item.value), enum_entry.underlying_type_size);
-                        return true;
-                    }
-                }
-            }
+            return false;
         }
-        return false;
+        const EnumItem* item = Impl::FindByName(enum_entry->items, enum_entry->item_index, item_name);
+        if (item == nullptr)
+        {
+            return false;
+        }
+        memcpy(out_value, reinterpret_cast<const void*>(&item->value), enum_entry->underlying_type_size);
+        return true;
     }
 
 private:
-    static inline std::vector<EnumEntry> s_entries = __enum_collection_entries__;
+__enum_collection_entries__
 };
 )";
 
@@ -322,30 +453,22 @@ constexpr const char* k_class_collection_template = R"(struct ClassCollection
 {
     static bool GetClassEntry(const char* name, const ClassEntry*& out_entry)
     {
-        for (const ClassEntry& entry : entries)
+        const ClassEntry* entry = Impl::FindByName(k_entries, k_index, name);
+        if (entry == nullptr)
         {
-            if (strcmp(entry.name, name) == 0)
-            {
-                out_entry = &entry;
-                return true;
-            }
+            return false;
         }
-        return false;
+        out_entry = entry;
+        return true;
     }
 
     static void* Construct(const char* name, Opal::AllocatorBase* allocator)
     {
-        for (const ClassEntry& entry : entries)
-        {
-            if (strcmp(entry.name, name) == 0)
-            {
-                return entry.create(allocator);
-            }
-        }
-        return nullptr;
+        const ClassEntry* entry = Impl::FindByName(k_entries, k_index, name);
+        return entry != nullptr ? entry->create(allocator) : nullptr;
     }
 
-    static bool GetClassProperties(const ClassEntry& class_entry, const std::vector<Property>*& out_properties)
+    static bool GetClassProperties(const ClassEntry& class_entry, const Span<Property>*& out_properties)
     {
         out_properties = &class_entry.properties;
         return true;
@@ -353,15 +476,13 @@ constexpr const char* k_class_collection_template = R"(struct ClassCollection
 
     static bool GetProperty(const ClassEntry& class_entry, const char* property_name, const Property*& out_prop)
     {
-        for (const Property& prop : class_entry.properties)
+        const Property* prop = Impl::FindByName(class_entry.properties, class_entry.property_index, property_name);
+        if (prop == nullptr)
         {
-            if (strcmp(prop.name, property_name) == 0)
-            {
-                out_prop = &prop;
-                return true;
-            }
+            return false;
         }
-        return false;
+        out_prop = prop;
+        return true;
     }
 
     static bool Read(void* out_value, void* object, const char* class_name, const char* property_name)
@@ -370,21 +491,13 @@ constexpr const char* k_class_collection_template = R"(struct ClassCollection
         {
             return false;
         }
-        for (const ClassEntry& class_entry : entries)
+        const ClassEntry* class_entry = Impl::FindByName(k_entries, k_index, class_name);
+        if (class_entry == nullptr)
         {
-            if (strcmp(class_entry.name, class_name) != 0)
-            {
-                continue;
-            }
-            for (const Property& prop : class_entry.properties)
-            {
-                if (strcmp(prop.name, property_name) == 0)
-                {
-                    return Read(out_value, object, prop);
-                }
-            }
+            return false;
         }
-        return false;
+        const Property* prop = Impl::FindByName(class_entry->properties, class_entry->property_index, property_name);
+        return prop != nullptr && Read(out_value, object, *prop);
     }
 
     static bool Read(void* out_value, void* object, const Property& prop)
@@ -403,21 +516,13 @@ constexpr const char* k_class_collection_template = R"(struct ClassCollection
         {
             return false;
         }
-        for (const ClassEntry& class_entry : entries)
+        const ClassEntry* class_entry = Impl::FindByName(k_entries, k_index, class_name);
+        if (class_entry == nullptr)
         {
-            if (strcmp(class_entry.name, class_name) != 0)
-            {
-                continue;
-            }
-            for (const Property& prop : class_entry.properties)
-            {
-                if (strcmp(prop.name, property_name) == 0)
-                {
-                    return Write(value, object, prop);
-                }
-            }
+            return false;
         }
-        return false;
+        const Property* prop = Impl::FindByName(class_entry->properties, class_entry->property_index, property_name);
+        return prop != nullptr && Write(value, object, *prop);
     }
 
     static bool Write(void* value, void* object, const Property& prop)
@@ -431,7 +536,7 @@ constexpr const char* k_class_collection_template = R"(struct ClassCollection
     }
 
 private:
-    static inline const std::vector<ClassEntry> entries = __class_collection_entries__;
+__class_collection_entries__
 };
 )";
 
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "opal/container/dynamic-array.h"
+#include "opal/container/hash-set.h"
 #include "opal/container/string.h"
+#include "opal/container/string-format.h"
 #include "opal/exceptions.h"
 #include "opal/logging.h"
 #include "opal/types.h"
@@ -52,6 +54,9 @@ struct CppAttribute
 struct CppEnum
 {
     Opal::StringUtf8 containing_file_path;
+    // Normalized path of the input file this record is extracted from, so the cache knows which input files need to be parsed
+    // again when the declaring header changes. Empty if it's not known.
+    Opal::StringUtf8 translation_unit_path;
     Opal::StringUtf8 name;
     Opal::StringUtf8 full_name;
     Opal::StringUtf8 scope;
@@ -66,6 +71,7 @@ struct CppEnum
     {
         CppEnum clone;
         clone.containing_file_path = containing_file_path.Clone();
+        clone.translation_unit_path = translation_unit_path.Clone();
         clone.name = name.Clone();
         clone.full_name = full_name.Clone();
         clone.scope = scope.Clone();
@@ -112,6 +118,9 @@ struct CppProperty
 struct CppClass
 {
     Opal::StringUtf8 containing_file_path;
+    // Normalized path of the input file this record is extracted from, so the cache knows which input files need to be parsed
+    // again when the declaring header changes. Empty if it's not known.
+    Opal::StringUtf8 translation_unit_path;
     Opal::StringUtf8 name;
     Opal::StringUtf8 full_name;
     Opal::StringUtf8 scope;
@@ -126,6 +135,7 @@ struct CppClass
     {
         CppClass clone;
         clone.containing_file_path = containing_file_path.Clone();
+        clone.translation_unit_path = translation_unit_path.Clone();
         clone.name = name.Clone();
         clone.full_name = full_name.Clone();
         clone.scope = scope.Clone();
@@ -139,6 +149,24 @@ struct CppClass
     }
 };
 
+enum class TraversalMode : u8
+{
+    // Visit every cursor in the translation unit, including system headers.
+    Full,
+    // Don't descend into declarations coming from system headers.
+    SkipSystemHeaders,
+    // Only descend into declarations coming from one of the input files.
+    InputsOnly,
+};
+
+enum class ParseProfile : u8
+{
+    // Parse everything, same as a regular compilation.
+    Full,
+    // Skip work that has no effect on reflection data, such as parsing function bodies.
+    Reflection,
+};
+
 struct ObsidianArguments
 {
     Opal::DynamicArray<Opal::StringUtf8> input_files;
@@ -147,13 +175,73 @@ struct ObsidianArguments
     Opal::StringUtf8 standard_version = "-std=c++20";
     Opal::DynamicArray<Opal::StringUtf8> compile_options;
     Opal::DynamicArray<Opal::StringUtf8> include_directories;
+    Opal::StringUtf8 prelude_file;
+    Opal::StringUtf8 jobs = "auto";
+    Opal::StringUtf8 memory_budget;
+    Opal::StringUtf8 depfile;
+    Opal::StringUtf8 dump_cache;
+    Opal::StringUtf8 cache_file;
     bool should_dump_ast = false;
+    bool should_prescan = false;
+    bool use_unity_build = false;
+    bool keep_going = false;
     bool use_separate_files = false;
+    TraversalMode traversal_mode = TraversalMode::Full;
+    ParseProfile parse_profile = ParseProfile::Full;
     Opal::LogLevel log_level = Opal::LogLevel::Error;
 
     Opal::DynamicArray<Opal::StringUtf8> include_directories_as_option;
+    u32 job_count = 1;
+    u64 memory_budget_bytes = 0;
+};
+
+/**
+ * Headers included by a translation unit, directly or transitively, excluding system headers.
+ */
+struct TranslationUnitIncludes
+{
+    // Normalized paths of input files parsed by the translation unit, more than one for unity batches.
+    Opal::DynamicArray<Opal::StringUtf8> input_files;
+    Opal::DynamicArray<Opal::StringUtf8> included_files;
+};
+
+struct AllocationStats
+{
+    u64 allocation_count = 0;
+    u64 allocated_bytes = 0;
+
+    AllocationStats operator-(const AllocationStats& other) const
+    {
+        return {.allocation_count = allocation_count - other.allocation_count, .allocated_bytes = allocated_bytes - other.allocated_bytes};
+    }
+};
+
+/**
+ * How the work of a phase was split between workers. Used to report how well the phase is parallelized.
+ */
+struct ParallelPhaseStats
+{
+    u32 worker_count = 0;
+    f32 duration = 0.0f;
+    // Sum of the durations of all work items.
+    f32 work_duration = 0.0f;
+    // A work item runs on a single worker, so the longest one is a lower bound for the duration of the phase.
+    f32 longest_item_duration = 0.0f;
+    Opal::StringUtf8 longest_item;
+
+    void AddItem(f64 item_duration, const Opal::StringUtf8& item_name)
+    {
+        work_duration += static_cast<f32>(item_duration);
+        if (item_duration > longest_item_duration)
+        {
+            longest_item_duration = static_cast<f32>(item_duration);
+            longest_item = item_name.Clone();
+        }
+    }
 };
 
+class CountingAllocator;
+
 struct CppContext
 {
     ObsidianArguments arguments;
@@ -161,10 +249,41 @@ struct CppContext
     Opal::DynamicArray<CppEnum> enums;
     Opal::DynamicArray<CppClass> classes;
     Opal::DynamicArray<Opal::StringUtf8> files_to_include;
+    Opal::DynamicArray<TranslationUnitIncludes> includes;
+    // Normalized paths of files written by the previous run, taken from the cache, and by this run. Files that were written
+    // last time but not this time are removed.
+    Opal::DynamicArray<Opal::StringUtf8> previous_generated_files;
+    Opal::DynamicArray<Opal::StringUtf8> generated_files;
+
+    // Parse durations of input files, keyed by normalized path. Estimates come from the previous run and are used to start
+    // parsing the most expensive files first, measured durations are stored in the cache for the next run.
+    Opal::HashMap<Opal::StringUtf8, f64> estimated_parse_durations;
+    Opal::HashMap<Opal::StringUtf8, f64> measured_parse_durations;
+
+    u64 prescan_skipped_file_count = 0;
+    u64 visited_cursor_count = 0;
+    u64 pruned_cursor_count = 0;
+
+    // Largest amount of memory held by a single translation unit, used to limit the number of concurrent translation units
+    // when there is a memory budget. The estimate comes from the previous run.
+    u64 estimated_translation_unit_memory = 0;
+    u64 peak_translation_unit_memory = 0;
+
+    ParallelPhaseStats hashing_stats;
+    ParallelPhaseStats compilation_stats;
+    ParallelPhaseStats generation_stats;
 
     f32 cache_duration = 0.0f;
+    f32 prescan_duration = 0.0f;
+    f32 prelude_duration = 0.0f;
     f32 compilation_duration = 0.0f;
     f32 generation_duration = 0.0f;
+
+    // Allocator installed as the default one, counts the heap allocations of each phase.
+    CountingAllocator* allocation_counter = nullptr;
+    AllocationStats compilation_allocations;
+    AllocationStats generation_allocations;
+    AllocationStats generation_arena_allocations;
 };
 
 struct ArgumentValidationException : Opal::Exception
@@ -180,9 +299,25 @@ struct TranslationFailedException : Opal::Exception
     }
 };
 
+struct CompilationFailedException : Opal::Exception
+{
+    explicit CompilationFailedException(u64 failed_file_count)
+        : Opal::Exception(Opal::StringEx("Failed to compile ") + *Opal::Format("{}", failed_file_count) + " C++ file(s)")
+    {
+    }
+};
+
 struct FileWriteException : Opal::Exception
 {
     explicit FileWriteException(const Opal::StringUtf8& file_path) : Opal::Exception(Opal::StringEx("Failed to write file: ") + *file_path)
     {
     }
+};
+
+/**
+ * Thrown by CacheView when data it reads points outside of its section of the cache file.
+ */
+struct CacheCorruptException : Opal::Exception
+{
+    CacheCorruptException() : Opal::Exception(Opal::StringEx("Cache file is corrupt")) {}
 };
\ No newline at end of file
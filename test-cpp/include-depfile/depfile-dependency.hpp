@@ -0,0 +1,6 @@
+#pragma once
+
+// Included by depfile-types.hpp but not an input file, the depfile test modifies it and expects the input file to be parsed
+// again.
+
+constexpr int k_depfile_first_value = 1;
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "obs/obs.hpp"
+
+#include "depfile-dependency.hpp"
+
+OBS_ENUM()
+enum class DepfileEnum
+{
+    First = k_depfile_first_value,
+    Second,
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+// Includes shared by all test headers, used to test precompiled prelude support.
+
+#include <cstdint>
+#include <string>
+
+#include "obs/obs.hpp"
@@ -0,0 +1,81 @@
+# run-depfile-test.cmake
+# CMake script executed via cmake -P to check that a change to a header that is included by an input file, but is not an
+# input file itself, makes obsidian parse the input file again and that the header is listed in the depfile.
+#
+# Expected variables (passed via -D):
+#   OBSIDIAN_EXE - Path to the obsidian executable
+#   SOURCE_DIR   - Directory with depfile-types.hpp and depfile-dependency.hpp
+#   OUTPUT_DIR   - Directory for the copied headers and obsidian output
+#   INC_DIRS     - Comma-separated include directories for obsidian
+
+if (NOT DEFINED OBSIDIAN_EXE)
+    message(FATAL_ERROR "OBSIDIAN_EXE is not defined")
+endif ()
+if (NOT DEFINED SOURCE_DIR)
+    message(FATAL_ERROR "SOURCE_DIR is not defined")
+endif ()
+if (NOT DEFINED OUTPUT_DIR)
+    message(FATAL_ERROR "OUTPUT_DIR is not defined")
+endif ()
+if (NOT DEFINED INC_DIRS)
+    message(FATAL_ERROR "INC_DIRS is not defined")
+endif ()
+
+# Headers are copied so that the test can modify them, and the output is recreated so that the first run can't be cached.
+set(HEADER_DIR "${OUTPUT_DIR}/headers")
+set(GEN_OUTPUT "${OUTPUT_DIR}/gen")
+set(DEPFILE "${GEN_OUTPUT}/reflection.d")
+file(REMOVE_RECURSE "${OUTPUT_DIR}")
+file(MAKE_DIRECTORY "${HEADER_DIR}" "${GEN_OUTPUT}")
+file(COPY "${SOURCE_DIR}/depfile-types.hpp" "${SOURCE_DIR}/depfile-dependency.hpp" DESTINATION "${HEADER_DIR}")
+
+function(run_obsidian OUT_OUTPUT)
+    execute_process(
+        COMMAND "${OBSIDIAN_EXE}"
+            input-files=${HEADER_DIR}/depfile-types.hpp
+            output-dir=${GEN_OUTPUT}
+            inc-dirs=${INC_DIRS}
+            depfile=${DEPFILE}
+        RESULT_VARIABLE OBSIDIAN_RESULT
+        OUTPUT_VARIABLE OBSIDIAN_OUTPUT
+        ERROR_VARIABLE OBSIDIAN_OUTPUT
+    )
+    message("${OBSIDIAN_OUTPUT}")
+    if (NOT OBSIDIAN_RESULT EQUAL 0)
+        message(FATAL_ERROR "obsidian failed with exit code ${OBSIDIAN_RESULT}")
+    endif ()
+    set(${OUT_OUTPUT} "${OBSIDIAN_OUTPUT}" PARENT_SCOPE)
+endfunction()
+
+set(CACHED_MESSAGE "Everything cached")
+
+# First run parses everything and writes the depfile.
+run_obsidian(FIRST_OUTPUT)
+string(FIND "${FIRST_OUTPUT}" "${CACHED_MESSAGE}" CACHED_POSITION)
+if (NOT CACHED_POSITION EQUAL -1)
+    message(FATAL_ERROR "First run was cached")
+endif ()
+if (NOT EXISTS "${DEPFILE}")
+    message(FATAL_ERROR "Depfile ${DEPFILE} was not written")
+endif ()
+file(READ "${DEPFILE}" DEPFILE_CONTENT)
+string(FIND "${DEPFILE_CONTENT}" "depfile-dependency.hpp" DEPENDENCY_POSITION)
+if (DEPENDENCY_POSITION EQUAL -1)
+    message(FATAL_ERROR "Depfile doesn't list the included header depfile-dependency.hpp:\n${DEPFILE_CONTENT}")
+endif ()
+
+# Nothing changed, so the second run must be cached, otherwise the last check would pass even with a broken cache.
+run_obsidian(SECOND_OUTPUT)
+string(FIND "${SECOND_OUTPUT}" "${CACHED_MESSAGE}" CACHED_POSITION)
+if (CACHED_POSITION EQUAL -1)
+    message(FATAL_ERROR "Second run wasn't cached even though nothing changed")
+endif ()
+
+# Change the contents of the included header, the size changes too so the change can't be missed because of the resolution
+# of modification times.
+file(APPEND "${HEADER_DIR}/depfile-dependency.hpp" "\nconstexpr int k_depfile_unused_value = 2;\n")
+run_obsidian(THIRD_OUTPUT)
+string(FIND "${THIRD_OUTPUT}" "${CACHED_MESSAGE}" CACHED_POSITION)
+if (NOT CACHED_POSITION EQUAL -1)
+    message(FATAL_ERROR "Change to the included header depfile-dependency.hpp didn't make obsidian parse the input file again")
+endif ()
@@ -0,0 +1,126 @@
+# run-generation-benchmark.cmake
+# CMake script executed via cmake -P that measures how the code generation step of obsidian scales with the number of reflected
+# types. Synthetic corpora of increasing size are generated and the "Generation duration" reported by obsidian is printed
+# together with the time spent per type, which should stay roughly constant as the corpus grows.
+#
+# Expected variables (passed via -D):
+#   OBSIDIAN_EXE     - Path to the obsidian executable
+#   OUTPUT_DIR       - Directory used for the synthetic corpora and generated files
+#   INC_DIRS         - Comma-separated include directories for obsidian
+#   COMPILE_OPTIONS  - (Optional) Comma-separated compile options for obsidian
+#   TYPE_COUNTS      - (Optional) Semicolon-separated numbers of types per corpus (default: 100;400;1600)
+
+if (NOT DEFINED OBSIDIAN_EXE)
+    message(FATAL_ERROR "OBSIDIAN_EXE is not defined")
+endif ()
+if (NOT DEFINED OUTPUT_DIR)
+    message(FATAL_ERROR "OUTPUT_DIR is not defined")
+endif ()
+if (NOT DEFINED INC_DIRS)
+    message(FATAL_ERROR "INC_DIRS is not defined")
+endif ()
+if (NOT DEFINED TYPE_COUNTS)
+    set(TYPE_COUNTS 100 400 1600)
+endif ()
+
+# Types are spread over headers with this many types each, so that parsing stays cheap compared to generation.
+set(TYPES_PER_HEADER 100)
+
+# Generates a corpus with the given number of reflected types. Every type is an enum with a few constants and a class with a
+# few properties, both with descriptions and attributes so that every placeholder of the templates gets a value.
+function(generate_corpus CORPUS_DIR TYPE_COUNT)
+    file(REMOVE_RECURSE "${CORPUS_DIR}")
+    file(MAKE_DIRECTORY "${CORPUS_DIR}")
+    math(EXPR LAST_TYPE "${TYPE_COUNT} - 1")
+    set(HEADER_CONTENT "")
+    set(HEADER_INDEX 0)
+    foreach (INDEX RANGE ${LAST_TYPE})
+        string(APPEND HEADER_CONTENT "
+/// Synthetic enum number ${INDEX}.
+OBS_ENUM(\"index=${INDEX}\")
+enum class Kind${INDEX}
+{
+    /// First constant.
+    First,
+    /// Second constant.
+    Second,
+    Third,
+    Fourth,
+    Fifth,
+    Sixth
+};
+
+/// Synthetic type number ${INDEX}.
+OBS_CLASS(\"index=${INDEX}\")
+struct Type${INDEX}
+{
+    OBS_PROP(\"min=0\")
+    int32_t id = ${INDEX};
+
+    /// Weight of the type.
+    OBS_PROP()
+    float weight = 1.0f;
+
+    OBS_PROP()
+    double scale = 2.0;
+
+    OBS_PROP()
+    Kind${INDEX} kind = Kind${INDEX}::First;
+};
+")
+        math(EXPR NEXT_INDEX "${INDEX} + 1")
+        math(EXPR HEADER_REMAINDER "${NEXT_INDEX} % ${TYPES_PER_HEADER}")
+        if (HEADER_REMAINDER EQUAL 0 OR INDEX EQUAL LAST_TYPE)
+            file(WRITE "${CORPUS_DIR}/synthetic-${HEADER_INDEX}.hpp" "#pragma once
+
+#include <cstdint>
+
+#include \"obs/obs.hpp\"
+
+namespace Synthetic
+{
+${HEADER_CONTENT}
+} // namespace Synthetic
+")
+            set(HEADER_CONTENT "")
+            math(EXPR HEADER_INDEX "${HEADER_INDEX} + 1")
+        endif ()
+    endforeach ()
+endfunction()
+
+foreach (TYPE_COUNT ${TYPE_COUNTS})
+    set(RUN_DIR "${OUTPUT_DIR}/types-${TYPE_COUNT}")
+    generate_corpus("${RUN_DIR}/corpus" ${TYPE_COUNT})
+    # The cache lives in the output directory, it's recreated empty so that a previous run is never picked up.
+    file(REMOVE_RECURSE "${RUN_DIR}/generated")
+    file(MAKE_DIRECTORY "${RUN_DIR}/generated")
+    set(OBSIDIAN_CMD "${OBSIDIAN_EXE}"
+        input-dirs=${RUN_DIR}/corpus
+        output-dir=${RUN_DIR}/generated
+        inc-dirs=${INC_DIRS}
+        parse-profile=reflection
+        log-level=info
+    )
+    if (DEFINED COMPILE_OPTIONS)
+        list(APPEND OBSIDIAN_CMD compile-options=${COMPILE_OPTIONS})
+    endif ()
+
+    execute_process(
+        COMMAND ${OBSIDIAN_CMD}
+        WORKING_DIRECTORY "${RUN_DIR}"
+        RESULT_VARIABLE OBSIDIAN_RESULT
+        OUTPUT_VARIABLE OBSIDIAN_OUTPUT
+        ERROR_VARIABLE OBSIDIAN_OUTPUT
+    )
+    if (NOT OBSIDIAN_RESULT EQUAL 0)
+        message(FATAL_ERROR "obsidian failed with exit code ${OBSIDIAN_RESULT}:\n${OBSIDIAN_OUTPUT}")
+    endif ()
+
+    string(REGEX MATCH "Generation duration: ([0-9.]+)" _ "${OBSIDIAN_OUTPUT}")
+    set(GENERATION_DURATION "${CMAKE_MATCH_1}")
+    # Both an enum and a class are generated for every type.
+    math(EXPR RECORD_COUNT "${TYPE_COUNT} * 2")
+    string(REGEX REPLACE "^([0-9]*)\\.([0-9][0-9][0-9]).*$" "\\1\\2" GENERATION_MS "${GENERATION_DURATION}")
+    math(EXPR MICROSECONDS_PER_RECORD "${GENERATION_MS} * 1000 / ${RECORD_COUNT}")
+    message(STATUS "${TYPE_COUNT} types: generation ${GENERATION_DURATION} s, ${MICROSECONDS_PER_RECORD} us per enum or class")
+endforeach ()
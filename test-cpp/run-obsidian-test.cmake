@@ -7,6 +7,8 @@
 #   OBSIDIAN_ARGS - Space-separated obsidian arguments (key=value format)
 #   TEST_EXE           - (Optional) Path to a test executable to run after obsidian
 #   EXPECTED_EXIT_CODE - (Optional) Expected obsidian exit code (default: 0)
+#   EXPECTED_OUTPUT    - (Optional) Space-separated strings that must all appear in the obsidian output
+#   REFERENCE_FILE     - (Optional) File that the generated reflection.hpp must be identical to
 
 if (NOT DEFINED OBSIDIAN_EXE)
     message(FATAL_ERROR "OBSIDIAN_EXE is not defined")
@@ -28,7 +30,10 @@ separate_arguments(ARG_LIST NATIVE_COMMAND "${OBSIDIAN_ARGS}")
 execute_process(
     COMMAND "${OBSIDIAN_EXE}" ${ARG_LIST}
     RESULT_VARIABLE OBSIDIAN_RESULT
+    OUTPUT_VARIABLE OBSIDIAN_OUTPUT
+    ERROR_VARIABLE OBSIDIAN_OUTPUT
 )
+message("${OBSIDIAN_OUTPUT}")
 
 if (DEFINED EXPECTED_EXIT_CODE)
     if (NOT OBSIDIAN_RESULT EQUAL ${EXPECTED_EXIT_CODE})
@@ -40,6 +45,28 @@ else ()
     endif ()
 endif ()
 
+# Optionally check the output.
+if (DEFINED EXPECTED_OUTPUT)
+    separate_arguments(EXPECTED_OUTPUT_LIST NATIVE_COMMAND "${EXPECTED_OUTPUT}")
+    foreach (EXPECTED_STRING ${EXPECTED_OUTPUT_LIST})
+        string(FIND "${OBSIDIAN_OUTPUT}" "${EXPECTED_STRING}" EXPECTED_STRING_POSITION)
+        if (EXPECTED_STRING_POSITION EQUAL -1)
+            message(FATAL_ERROR "obsidian output doesn't contain '${EXPECTED_STRING}'")
+        endif ()
+    endforeach ()
+endif ()
+
+# Optionally compare the generated code with the reference.
+if (DEFINED REFERENCE_FILE)
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files "${OUTPUT_DIR}/reflection.hpp" "${REFERENCE_FILE}"
+        RESULT_VARIABLE COMPARE_RESULT
+    )
+    if (NOT COMPARE_RESULT EQUAL 0)
+        message(FATAL_ERROR "${OUTPUT_DIR}/reflection.hpp differs from ${REFERENCE_FILE}")
+    endif ()
+endif ()
+
 # Optionally run the test executable.
 if (DEFINED TEST_EXE)
     execute_process(
@@ -0,0 +1,123 @@
+# run-parse-benchmark.cmake
+# CMake script executed via cmake -P that compares wall time and peak memory of obsidian parse profiles on the test-cpp
+# headers and on a synthetic corpus of headers with heavy inline function bodies.
+#
+# Expected variables (passed via -D):
+#   OBSIDIAN_EXE     - Path to the obsidian executable
+#   INPUT_DIR        - Path to the test-cpp/include directory
+#   OUTPUT_DIR       - Directory used for the synthetic corpus and generated files
+#   INC_DIRS         - Comma-separated include directories for obsidian
+#   COMPILE_OPTIONS  - (Optional) Comma-separated compile options for obsidian
+#   HEADER_COUNT     - (Optional) Number of headers in the synthetic corpus (default: 200)
+
+if (NOT DEFINED OBSIDIAN_EXE)
+    message(FATAL_ERROR "OBSIDIAN_EXE is not defined")
+endif ()
+if (NOT DEFINED INPUT_DIR)
+    message(FATAL_ERROR "INPUT_DIR is not defined")
+endif ()
+if (NOT DEFINED OUTPUT_DIR)
+    message(FATAL_ERROR "OUTPUT_DIR is not defined")
+endif ()
+if (NOT DEFINED INC_DIRS)
+    message(FATAL_ERROR "INC_DIRS is not defined")
+endif ()
+if (NOT DEFINED HEADER_COUNT)
+    set(HEADER_COUNT 200)
+endif ()
+
+# Generate the synthetic corpus. Every header has a reflected struct with a few properties and inline member functions
+# with bodies that instantiate standard library templates, which is what reflection-only parsing can skip.
+set(CORPUS_DIR "${OUTPUT_DIR}/corpus")
+file(REMOVE_RECURSE "${CORPUS_DIR}")
+file(MAKE_DIRECTORY "${CORPUS_DIR}")
+math(EXPR LAST_HEADER "${HEADER_COUNT} - 1")
+foreach (INDEX RANGE ${LAST_HEADER})
+    file(WRITE "${CORPUS_DIR}/synthetic-${INDEX}.hpp" "#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include \"obs/obs.hpp\"
+
+namespace Synthetic
+{
+
+/// Synthetic type number ${INDEX}.
+OBS_CLASS(\"index=${INDEX}\")
+struct Type${INDEX}
+{
+    OBS_PROP()
+    int32_t id = ${INDEX};
+
+    OBS_PROP()
+    float weight = 1.0f;
+
+    OBS_PROP()
+    std::string name = \"type-${INDEX}\";
+
+    std::vector<int32_t> values;
+    std::map<std::string, int32_t> lookup;
+
+    void Sort() { std::sort(values.begin(), values.end()); }
+    int32_t Sum() const
+    {
+        int32_t sum = 0;
+        for (const auto& value : values) sum += value;
+        for (const auto& [key, value] : lookup) sum += value + static_cast<int32_t>(key.size());
+        return sum;
+    }
+    void Insert(const std::string& key, int32_t value) { lookup[key] = value; values.push_back(value); }
+};
+
+} // namespace Synthetic
+")
+endforeach ()
+
+# Runs obsidian on the given input directory and reports its durations and peak memory usage.
+function(run_benchmark CORPUS_NAME CORPUS_INPUT_DIR PROFILE)
+    set(RUN_DIR "${OUTPUT_DIR}/${CORPUS_NAME}-${PROFILE}")
+    file(REMOVE_RECURSE "${RUN_DIR}")
+    file(MAKE_DIRECTORY "${RUN_DIR}")
+    set(OBSIDIAN_CMD "${OBSIDIAN_EXE}"
+        input-dirs=${CORPUS_INPUT_DIR}
+        output-dir=${RUN_DIR}
+        inc-dirs=${INC_DIRS}
+        parse-profile=${PROFILE}
+        log-level=info
+    )
+    if (DEFINED COMPILE_OPTIONS)
+        list(APPEND OBSIDIAN_CMD compile-options=${COMPILE_OPTIONS})
+    endif ()
+
+    string(TIMESTAMP START_TIME "%s%f" UTC)
+    # Each run gets its own working directory so that the cache of a previous run is never picked up.
+    execute_process(
+        COMMAND ${OBSIDIAN_CMD}
+        WORKING_DIRECTORY "${RUN_DIR}"
+        RESULT_VARIABLE OBSIDIAN_RESULT
+        OUTPUT_VARIABLE OBSIDIAN_OUTPUT
+        ERROR_VARIABLE OBSIDIAN_OUTPUT
+    )
+    string(TIMESTAMP END_TIME "%s%f" UTC)
+    if (NOT OBSIDIAN_RESULT EQUAL 0)
+        message(FATAL_ERROR "obsidian failed with exit code ${OBSIDIAN_RESULT}:\n${OBSIDIAN_OUTPUT}")
+    endif ()
+
+    math(EXPR WALL_TIME_MS "(${END_TIME} - ${START_TIME}) / 1000")
+    string(REGEX MATCH "Compilation duration: ([0-9.]+)" _ "${OBSIDIAN_OUTPUT}")
+    set(COMPILATION_DURATION "${CMAKE_MATCH_1}")
+    string(REGEX MATCH "Peak memory usage: ([0-9.]+)" _ "${OBSIDIAN_OUTPUT}")
+    set(PEAK_MEMORY "${CMAKE_MATCH_1}")
+    message(STATUS "${CORPUS_NAME} [${PROFILE}]: wall ${WALL_TIME_MS} ms, compilation ${COMPILATION_DURATION} s, peak memory ${PEAK_MEMORY} MB")
+endfunction()
+
+foreach (PROFILE full reflection)
+    run_benchmark(test-cpp "${INPUT_DIR}" ${PROFILE})
+endforeach ()
+foreach (PROFILE full reflection)
+    run_benchmark(synthetic-${HEADER_COUNT} "${CORPUS_DIR}" ${PROFILE})
+endforeach ()
@@ -0,0 +1,77 @@
+# run-separate-files-test.cmake
+# CMake script executed via cmake -P to check that a per-header file generated with separate-files=true is written again
+# when it's deleted between two runs, even though none of the inputs changed.
+#
+# Expected variables (passed via -D):
+#   OBSIDIAN_EXE    - Path to the obsidian executable
+#   INPUT_FILE      - Header passed to obsidian, its generated file is the one that gets deleted
+#   OUTPUT_DIR      - Directory for the obsidian output
+#   COMPILE_OPTIONS - Comma-separated compile options for obsidian
+#   INC_DIRS        - Comma-separated include directories for obsidian
+
+if (NOT DEFINED OBSIDIAN_EXE)
+    message(FATAL_ERROR "OBSIDIAN_EXE is not defined")
+endif ()
+if (NOT DEFINED INPUT_FILE)
+    message(FATAL_ERROR "INPUT_FILE is not defined")
+endif ()
+if (NOT DEFINED OUTPUT_DIR)
+    message(FATAL_ERROR "OUTPUT_DIR is not defined")
+endif ()
+if (NOT DEFINED COMPILE_OPTIONS)
+    message(FATAL_ERROR "COMPILE_OPTIONS is not defined")
+endif ()
+if (NOT DEFINED INC_DIRS)
+    message(FATAL_ERROR "INC_DIRS is not defined")
+endif ()
+
+# The output is recreated so that the first run can't be cached.
+file(REMOVE_RECURSE "${OUTPUT_DIR}")
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+get_filename_component(INPUT_NAME "${INPUT_FILE}" NAME_WE)
+set(SEPARATE_FILE "${OUTPUT_DIR}/${INPUT_NAME}.reflection.hpp")
+
+function(run_obsidian OUT_OUTPUT)
+    execute_process(
+        COMMAND "${OBSIDIAN_EXE}"
+            input-files=${INPUT_FILE}
+            output-dir=${OUTPUT_DIR}
+            compile-options=${COMPILE_OPTIONS}
+            inc-dirs=${INC_DIRS}
+            separate-files=true
+        RESULT_VARIABLE OBSIDIAN_RESULT
+        OUTPUT_VARIABLE OBSIDIAN_OUTPUT
+        ERROR_VARIABLE OBSIDIAN_OUTPUT
+    )
+    message("${OBSIDIAN_OUTPUT}")
+    if (NOT OBSIDIAN_RESULT EQUAL 0)
+        message(FATAL_ERROR "obsidian failed with exit code ${OBSIDIAN_RESULT}")
+    endif ()
+    set(${OUT_OUTPUT} "${OBSIDIAN_OUTPUT}" PARENT_SCOPE)
+endfunction()
+
+set(CACHED_MESSAGE "Everything cached")
+
+# First run generates the aggregate reflection.hpp and the per-header file.
+run_obsidian(FIRST_OUTPUT)
+if (NOT EXISTS "${SEPARATE_FILE}")
+    message(FATAL_ERROR "Per-header file ${SEPARATE_FILE} was not written")
+endif ()
+
+# Nothing changed, so the second run must be cached, otherwise the last check would pass even with a broken cache.
+run_obsidian(SECOND_OUTPUT)
+string(FIND "${SECOND_OUTPUT}" "${CACHED_MESSAGE}" CACHED_POSITION)
+if (CACHED_POSITION EQUAL -1)
+    message(FATAL_ERROR "Second run wasn't cached even though nothing changed")
+endif ()
+
+# reflection.hpp is still there, only the per-header file it includes is gone.
+file(REMOVE "${SEPARATE_FILE}")
+run_obsidian(THIRD_OUTPUT)
+string(FIND "${THIRD_OUTPUT}" "${CACHED_MESSAGE}" CACHED_POSITION)
+if (NOT CACHED_POSITION EQUAL -1)
+    message(FATAL_ERROR "Deleting ${SEPARATE_FILE} didn't make obsidian generate it again")
+endif ()
+if (NOT EXISTS "${SEPARATE_FILE}")
+    message(FATAL_ERROR "Per-header file ${SEPARATE_FILE} was not written again")
+endif ()
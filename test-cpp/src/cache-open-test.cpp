@@ -0,0 +1,150 @@
+// Checks that opening a cache file doesn't depend on its size. A no-op build only opens the cache, compares the input files and
+// returns, so opening a large synthetic cache has to stay under a millisecond. Decoding the whole cache is timed for comparison.
+// Run as part of the test suite with the path of the cache file to write as the only argument.
+
+#include <algorithm>
+#include <cstdio>
+
+#include "opal/time.h"
+
+#include "cache.hpp"
+
+static constexpr u32 k_file_count = 10000;
+static constexpr u32 k_dependency_file_count = 5000;
+static constexpr u32 k_dependencies_per_file = 32;
+static constexpr u32 k_enum_count = 20000;
+static constexpr u32 k_class_count = 20000;
+static constexpr u32 k_members_per_record = 8;
+static constexpr u32 k_open_count = 101;
+static constexpr f64 k_max_open_duration = 0.001;
+
+static Opal::StringUtf8 MakeHeaderPath(const char* directory, u32 index)
+{
+    return Opal::Format("/project/{}/header-{}.hpp", directory, index);
+}
+
+static Cache MakeSyntheticCache()
+{
+    Cache cache;
+    cache.app_version = "0.0.0";
+    cache.arguments_hash = 0x1234;
+    cache.has_records = true;
+    for (u32 i = 0; i < k_dependency_file_count; i++)
+    {
+        cache.dependency_files.PushBack({.path = MakeHeaderPath("dependencies", i), .last_modified = 1.0, .size = 1024});
+    }
+    for (u32 i = 0; i < k_file_count; i++)
+    {
+        FileEntry file{.path = MakeHeaderPath("inputs", i), .last_modified = 1.0, .size = 4096, .content_hash = i};
+        for (u32 j = 0; j < k_dependencies_per_file; j++)
+        {
+            file.dependencies.PushBack((i + j * 131) % k_dependency_file_count);
+        }
+        cache.files.PushBack(std::move(file));
+    }
+    for (u32 i = 0; i < k_enum_count; i++)
+    {
+        CppEnum cpp_enum;
+        cpp_enum.containing_file_path = MakeHeaderPath("inputs", i % k_file_count);
+        cpp_enum.translation_unit_path = cpp_enum.containing_file_path.Clone();
+        cpp_enum.name = Opal::Format("Enum{}", i);
+        cpp_enum.full_name = Opal::Format("Game::Enum{}", i);
+        cpp_enum.scope = "Game";
+        cpp_enum.underlying_type = "int";
+        cpp_enum.underlying_type_size = 4;
+        cpp_enum.is_enum_class = true;
+        for (u32 j = 0; j < k_members_per_record; j++)
+        {
+            CppEnumConstant constant;
+            constant.name = Opal::Format("Value{}", j);
+            constant.value = j;
+            cpp_enum.constants.PushBack(std::move(constant));
+        }
+        cache.enums.PushBack(std::move(cpp_enum));
+    }
+    for (u32 i = 0; i < k_class_count; i++)
+    {
+        CppClass cpp_class;
+        cpp_class.containing_file_path = MakeHeaderPath("inputs", i % k_file_count);
+        cpp_class.translation_unit_path = cpp_class.containing_file_path.Clone();
+        cpp_class.name = Opal::Format("Class{}", i);
+        cpp_class.full_name = Opal::Format("Game::Class{}", i);
+        cpp_class.scope = "Game";
+        cpp_class.is_struct = true;
+        cpp_class.alignment = 8;
+        cpp_class.size = 8 * k_members_per_record;
+        for (u32 j = 0; j < k_members_per_record; j++)
+        {
+            CppProperty property;
+            property.name = Opal::Format("member_{}", j);
+            property.type = "double";
+            property.full_type = "double";
+            property.is_pod = true;
+            property.alignment = 8;
+            property.offset = 8 * j;
+            property.size = 8;
+            cpp_class.properties.PushBack(std::move(property));
+        }
+        cache.classes.PushBack(std::move(cpp_class));
+    }
+    cache.generated_files.PushBack("/project/generated/reflection.hpp");
+    return cache;
+}
+
+int main(int argc, char** argv)
+{
+    Opal::MallocAllocator allocator;
+    Opal::PushDefaultAllocator(&allocator);
+
+    if (argc != 2)
+    {
+        printf("Usage: cache-open-test <cache-file>\n");
+        return 1;
+    }
+    const Opal::StringUtf8 cache_file_path = argv[1];
+    if (!WriteCacheFile(MakeSyntheticCache(), cache_file_path))
+    {
+        printf("Failed to write cache file %s\n", argv[1]);
+        return 1;
+    }
+
+    // Median of many opens, so that a single slow open on a busy machine doesn't fail the test.
+    f64 open_durations[k_open_count] = {};
+    CacheView view;
+    for (u32 i = 0; i < k_open_count; i++)
+    {
+        view.Close();
+        const f64 start_time = Opal::GetSeconds();
+        const bool is_opened = view.Open(cache_file_path);
+        open_durations[i] = Opal::GetSeconds() - start_time;
+        if (!is_opened)
+        {
+            printf("Failed to open cache file %s\n", argv[1]);
+            return 1;
+        }
+    }
+    std::sort(open_durations, open_durations + k_open_count);
+    const f64 open_duration = open_durations[k_open_count / 2];
+
+    const f64 decode_start_time = Opal::GetSeconds();
+    const Cache decoded = view.Decode();
+    const f64 decode_duration = Opal::GetSeconds() - decode_start_time;
+    printf("Cache: %u files, %u dependency files, %u enums, %u classes\n", k_file_count, k_dependency_file_count, k_enum_count,
+           k_class_count);
+    printf("Open:   %8.3f ms (median of %u)\n", open_duration * 1000.0, k_open_count);
+    printf("Decode: %8.3f ms\n", decode_duration * 1000.0);
+
+    if (decoded.files.GetSize() != k_file_count || decoded.classes.GetSize() != k_class_count ||
+        view.FindFile(MakeHeaderPath("inputs", k_file_count - 1)) != k_file_count - 1)
+    {
+        printf("Cache read back doesn't match the one that was written\n");
+        return 1;
+    }
+    if (open_duration > k_max_open_duration)
+    {
+        printf("Opening the cache took %.3f ms, it has to take less than %.3f ms\n", open_duration * 1000.0,
+               k_max_open_duration * 1000.0);
+        return 1;
+    }
+    return 0;
+}
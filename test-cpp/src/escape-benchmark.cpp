@@ -0,0 +1,142 @@
+// Compares the implementations of string literal escaping used by the generator on a synthetic corpus of doc comments. Not
+// part of the test suite, run with: cmake --build <build-dir> --target obsidian-escape-benchmark
+
+#include <cstdio>
+
+#include "opal/time.h"
+
+#include "escape.hpp"
+
+// Escaping as it was done before the scanners were added, one byte at a time into a new string.
+static Opal::StringUtf8 EscapeBytewise(const Opal::StringUtf8& input)
+{
+    Opal::StringUtf8 result;
+    const char* data = input.GetData();
+    const u64 size = input.GetSize();
+    for (u64 i = 0; i < size; i++)
+    {
+        switch (data[i])
+        {
+            case '\\':
+                result += "\\\\";
+                break;
+            case '"':
+                result += "\\\"";
+                break;
+            case '\n':
+                result += "\\n";
+                break;
+            case '\r':
+                result += "\\r";
+                break;
+            case '\t':
+                result += "\\t";
+                break;
+            default:
+                result += Opal::StringUtf8(&data[i], 1);
+                break;
+        }
+    }
+    return result;
+}
+
+static u32 NextRandom(u32& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// Most comments are one line briefs, some are long multi-line descriptions with quotes, paths and indented code, like the
+// ones returned by clang_Cursor_getBriefCommentText and clang_Cursor_getRawCommentText.
+static Opal::DynamicArray<Opal::StringUtf8> GenerateCorpus(u32 comment_count)
+{
+    static constexpr const char* k_words[] = {"the",      "value",  "of",     "this",    "property", "is",       "used",
+                                              "when",     "object", "loaded", "from",    "disk",     "returns",  "number",
+                                              "elements", "in",     "buffer", "default", "should",   "never",    "be",
+                                              "negative", "see",    "also",   "entity",  "render",   "texture",  "handle"};
+    static constexpr const char* k_specials[] = {"\"quoted\"", "C:\\Assets\\Textures", "\n", "\n\t", "\r\n"};
+    Opal::DynamicArray<Opal::StringUtf8> corpus;
+    u32 state = 12345;
+    for (u32 i = 0; i < comment_count; i++)
+    {
+        const u32 word_count = NextRandom(state) % 10 == 0 ? 200 + NextRandom(state) % 300 : 5 + NextRandom(state) % 15;
+        Opal::StringUtf8 comment;
+        for (u32 j = 0; j < word_count; j++)
+        {
+            if (j > 0)
+            {
+                comment += " ";
+            }
+            if (NextRandom(state) % 25 == 0)
+            {
+                comment += k_specials[NextRandom(state) % (sizeof(k_specials) / sizeof(k_specials[0]))];
+            }
+            else
+            {
+                comment += k_words[NextRandom(state) % (sizeof(k_words) / sizeof(k_words[0]))];
+            }
+        }
+        corpus.PushBack(std::move(comment));
+    }
+    return corpus;
+}
+
+int main()
+{
+    Opal::MallocAllocator allocator;
+    Opal::PushDefaultAllocator(&allocator);
+
+    constexpr u32 k_comment_count = 20000;
+    constexpr u32 k_iteration_count = 20;
+    const Opal::DynamicArray<Opal::StringUtf8> corpus = GenerateCorpus(k_comment_count);
+    u64 corpus_size = 0;
+    for (const auto& comment : corpus)
+    {
+        corpus_size += comment.GetSize();
+    }
+    printf("Corpus: %u comments, %.2f MB\n", k_comment_count, static_cast<f64>(corpus_size) / (1024.0 * 1024.0));
+
+    // Every implementation escapes the whole corpus into one output string, and has to produce the same output.
+    Opal::StringUtf8 expected;
+    f64 start_time = Opal::GetSeconds();
+    for (u32 iteration = 0; iteration < k_iteration_count; iteration++)
+    {
+        expected.Clear();
+        for (const auto& comment : corpus)
+        {
+            expected += EscapeBytewise(comment);
+        }
+    }
+    f64 duration = (Opal::GetSeconds() - start_time) / k_iteration_count;
+    printf("%-8s %8.3f ms %10.1f MB/s\n", "bytewise", duration * 1000.0,
+           static_cast<f64>(corpus_size) / (1024.0 * 1024.0) / duration);
+
+    for (const EscapeScanner scanner : {EscapeScanner::Scalar, EscapeScanner::Sse2, EscapeScanner::Avx2})
+    {
+        if (!IsEscapeScannerSupported(scanner))
+        {
+            printf("%-8s not supported\n", GetEscapeScannerName(scanner));
+            continue;
+        }
+        Opal::StringUtf8 output;
+        start_time = Opal::GetSeconds();
+        for (u32 iteration = 0; iteration < k_iteration_count; iteration++)
+        {
+            output.Clear();
+            for (const auto& comment : corpus)
+            {
+                AppendEscapedCppString(output, comment.GetData(), comment.GetSize(), scanner);
+            }
+        }
+        duration = (Opal::GetSeconds() - start_time) / k_iteration_count;
+        printf("%-8s %8.3f ms %10.1f MB/s\n", GetEscapeScannerName(scanner), duration * 1000.0,
+               static_cast<f64>(corpus_size) / (1024.0 * 1024.0) / duration);
+        if (output != expected)
+        {
+            printf("Output of %s doesn't match the bytewise implementation\n", GetEscapeScannerName(scanner));
+            return 1;
+        }
+    }
+    printf("Runtime dispatch picks %s\n", GetEscapeScannerName(GetBestEscapeScanner()));
+    return 0;
+}
@@ -367,7 +367,7 @@ TEST_CASE("Class collection", "[refl][class-collection]")
         const Obs::ClassEntry* entry = nullptr;
         REQUIRE(Obs::ClassCollection::GetClassEntry("DataStruct", entry));
 
-        const std::vector<Obs::Property>* props = nullptr;
+        const Obs::Span<Obs::Property>* props = nullptr;
         REQUIRE(Obs::ClassCollection::GetClassProperties(*entry, props));
         REQUIRE(props->size() == 5);
         REQUIRE(strcmp((*props)[0].name, "a") == 0);
@@ -0,0 +1,111 @@
+// Compares the lookup of reflected types by name through the perfect hash emitted by the generator with the linear search
+// that was used before. Not part of the test suite, run with: cmake --build <build-dir> --target obsidian-name-lookup-benchmark
+
+#include <cstdio>
+#include <cstring>
+
+#include "opal/time.h"
+
+#include "perfect-hash.hpp"
+
+// Lookup results are stored here so that the compiler can't remove the lookups.
+static volatile u32 s_result_sink = 0;
+
+static u32 NextRandom(u32& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// Names look like reflected types, with a few common prefixes so that the linear search can't reject most of them on the first
+// character.
+static Opal::DynamicArray<Opal::StringUtf8> GenerateNames(u32 name_count)
+{
+    static constexpr const char* k_prefixes[] = {"Render", "Physics", "Audio", "Entity", "Ui", "Net"};
+    static constexpr const char* k_suffixes[] = {"Component", "System", "Settings", "State", "Desc", "Event"};
+    Opal::DynamicArray<Opal::StringUtf8> names;
+    for (u32 i = 0; i < name_count; i++)
+    {
+        names.PushBack(Opal::Format("{}Object{}{}", k_prefixes[i % 6], i, k_suffixes[(i / 6) % 6]));
+    }
+    return names;
+}
+
+static u32 FindLinear(const Opal::DynamicArray<Opal::StringUtf8>& names, const char* name)
+{
+    for (u64 i = 0; i < names.GetSize(); i++)
+    {
+        if (strcmp(names[i].GetData(), name) == 0)
+        {
+            return static_cast<u32>(i);
+        }
+    }
+    return PerfectHash::k_not_found;
+}
+
+// Same steps as Impl::FindByName in the generated code.
+static u32 FindPerfectHash(const PerfectHash& hash, const Opal::DynamicArray<Opal::StringUtf8>& names, const char* name)
+{
+    const u32 index = hash.Find(name);
+    return index != PerfectHash::k_not_found && strcmp(names[index].GetData(), name) == 0 ? index : PerfectHash::k_not_found;
+}
+
+int main()
+{
+    Opal::MallocAllocator allocator;
+    Opal::PushDefaultAllocator(&allocator);
+
+    constexpr u32 k_lookup_count = 1000000;
+    printf("%8s %12s %14s %14s %9s\n", "types", "build ms", "linear ns/op", "hash ns/op", "speedup");
+    for (const u32 name_count : {8u, 64u, 512u, 4096u, 32768u})
+    {
+        const Opal::DynamicArray<Opal::StringUtf8> names = GenerateNames(name_count);
+        Opal::DynamicArray<const Opal::StringUtf8*> name_pointers;
+        for (const auto& name : names)
+        {
+            name_pointers.PushBack(&name);
+        }
+
+        f64 start_time = Opal::GetSeconds();
+        const PerfectHash hash = BuildPerfectHash(name_pointers);
+        const f64 build_duration = Opal::GetSeconds() - start_time;
+
+        // One in sixteen lookups is a name that isn't reflected.
+        Opal::DynamicArray<Opal::StringUtf8> queries;
+        u32 state = 12345;
+        for (u32 i = 0; i < 4096; i++)
+        {
+            const u32 index = NextRandom(state) % name_count;
+            queries.PushBack(i % 16 == 0 ? Opal::Format("Missing{}", index) : names[index].Clone());
+        }
+
+        for (const auto& query : queries)
+        {
+            if (FindLinear(names, query.GetData()) != FindPerfectHash(hash, names, query.GetData()))
+            {
+                printf("Perfect hash lookup of %s doesn't match the linear search\n", query.GetData());
+                return 1;
+            }
+        }
+
+        // Linear search gets fewer lookups on large tables, otherwise it would run for minutes.
+        const u32 linear_lookup_count = name_count > 512 ? k_lookup_count / (name_count / 512) : k_lookup_count;
+        start_time = Opal::GetSeconds();
+        for (u32 i = 0; i < linear_lookup_count; i++)
+        {
+            s_result_sink = FindLinear(names, queries[i % queries.GetSize()].GetData());
+        }
+        const f64 linear_duration = (Opal::GetSeconds() - start_time) / linear_lookup_count;
+
+        start_time = Opal::GetSeconds();
+        for (u32 i = 0; i < k_lookup_count; i++)
+        {
+            s_result_sink = FindPerfectHash(hash, names, queries[i % queries.GetSize()].GetData());
+        }
+        const f64 hash_duration = (Opal::GetSeconds() - start_time) / k_lookup_count;
+
+        printf("%8u %12.3f %14.1f %14.1f %8.1fx\n", name_count, build_duration * 1000.0, linear_duration * 1e9, hash_duration * 1e9,
+               linear_duration / hash_duration);
+    }
+    return 0;
+}
@@ -0,0 +1,15 @@
+// This file verifies that the headers generated with separate-files=true can be included on their own, without the
+// aggregate reflection.hpp. The rest of the test suite is built against the aggregate in the same executable.
+
+#include "catch2/catch2.hpp"
+
+#include "reflection-core.hpp"
+#include "types.reflection.hpp"
+
+TEST_CASE("Per-header reflection file", "[refl][separate-files]")
+{
+    REQUIRE(strcmp(Obs::Enum<GlobalColor>::GetName(), "GlobalColor") == 0);
+    REQUIRE(Obs::Enum<GlobalColor>::GetValue("Blue") == GlobalColor::Blue);
+    REQUIRE(strcmp(Obs::Class<GlobalPoint>::GetName(), "GlobalPoint") == 0);
+    REQUIRE(Obs::Class<GlobalPoint>::GetProperties().size() == 2);
+}